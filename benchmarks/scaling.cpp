@@ -0,0 +1,118 @@
+/**
+ * Scaling benchmark of the layout on large synthetic graph families.
+ *
+ * Each family is laid out at sizes growing by a factor of 10 up to 10^6 edges.
+ * The times of the stages come from the statistics of the layout. Every layout runs in a separate
+ * process, so its peak resident set size is not affected by the previous ones, and it is killed
+ * when it takes longer than the time limit.
+ * The larger sizes of a family are skipped after the first layout which hits the limit.
+ *
+ * usage: scaling [time limit in seconds] [family]
+ */
+#include <drag/layout.hpp>
+#include <drag/detail/gen.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace drag;
+
+
+struct family {
+    std::string name;
+    std::function< graph(dag_generator&, size_t edges) > generate;
+};
+
+std::vector<family> families() {
+    return {
+        { "chain", [] (dag_generator& gen, size_t m) { return gen.generate_chain(m*2/3, m); } },
+        { "tree", [] (dag_generator& gen, size_t m) { return gen.generate_tree(m + 1, 8); } },
+        { "layered", [] (dag_generator& gen, size_t m) { return gen.generate_layered(m/2, m, 50); } },
+        { "power-law", [] (dag_generator& gen, size_t m) { return gen.generate_power_law(m/3, m); } },
+        { "components", [] (dag_generator& gen, size_t m) { return gen.generate_components(m/15, 10, 15); } },
+        { "cyclic", [] (dag_generator& gen, size_t m) { return gen.generate_cyclic(m/2, m); } },
+    };
+}
+
+// the peak resident set size of the process in MiB, the one after generating the graph is the baseline
+double peak_rss() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;
+}
+
+double ms(layout_stats::duration d) {
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+// generates the graph and lays it out, prints one row of the results
+void run(const family& f, size_t edges) {
+    dag_generator gen(5);
+    graph g = f.generate(gen, edges);
+    double base_rss = peak_rss();
+
+    sugiyama_layout layout(g);
+    const auto& s = layout.statistics();
+    std::printf("%-11s %8u %8zu %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+                f.name.c_str(), g.size(), edges,
+                ms(s.split), ms(s.cycle_removal), ms(s.layering), ms(s.dummy_insertion),
+                ms(s.crossing_reduction), ms(s.positioning), ms(s.routing), ms(s.total()),
+                base_rss, peak_rss());
+    std::fflush(stdout);
+}
+
+// runs the layout in a child process, returns false if it didn't finish in time
+bool run_limited(const family& f, size_t edges, std::chrono::seconds limit) {
+    std::fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        run(f, edges);
+        std::_Exit(0);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    int status = 0;
+    while (waitpid(pid, &status, WNOHANG) == 0) {
+        if (std::chrono::steady_clock::now() - start > limit) {
+            kill(pid, SIGKILL);
+            waitpid(pid, &status, 0);
+            std::printf("%-11s %8s %8zu   time limit exceeded\n", f.name.c_str(), "", edges);
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+
+    if (WIFSIGNALED(status)) {
+        std::printf("%-11s %8s %8zu   killed by signal %d\n", f.name.c_str(), "", edges, WTERMSIG(status));
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    std::chrono::seconds limit { argc > 1 ? std::atoi(argv[1]) : 60 };
+    std::string filter = argc > 2 ? argv[2] : "";
+
+    std::printf("%-11s %8s %8s %9s %9s %9s %9s %9s %9s %9s %9s %9s %9s\n", "family", "vertices", "edges",
+                "split", "cycles", "layering", "dummies", "crossing", "position", "routing", "total ms", "graph MiB", "peak MiB");
+    std::fflush(stdout);
+
+    for (const auto& f : families()) {
+        if (f.name.find(filter) == std::string::npos)
+            continue;
+        for (size_t edges = 1000; edges <= 1000000; edges *= 10) {
+            if (!run_limited(f, edges, limit))
+                break;
+        }
+    }
+}
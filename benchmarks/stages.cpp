@@ -0,0 +1,234 @@
+/**
+ * Microbenchmarks of the individual stages of the layout.
+ *
+ * Each stage is measured on random DAGs of several sizes and densities. Only the stage
+ * itself is timed, the stages it depends on are run beforehand for every repetition.
+ * The allocations are counted by replacing the global operator new and delete.
+ *
+ * usage: stages [filter]
+ * Only the benchmarks whose name contains the filter are run.
+ */
+#include <drag/layout.hpp>
+#include <drag/drawing/draw.hpp>
+#include <drag/detail/gen.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <new>
+#include <optional>
+#include <string>
+
+using namespace drag;
+
+
+// the number of allocations made by the program so far
+static std::size_t allocations = 0;
+
+/*
+ * All the replaceable forms of operator new and delete are replaced, so the array and aligned
+ * allocations are counted too and every allocation is freed by the matching function.
+ * The nothrow forms call these by default.
+ */
+static void* allocate(std::size_t size) {
+    ++allocations;
+    if (void* p = std::malloc(size == 0 ? 1 : size))
+        return p;
+    throw std::bad_alloc();
+}
+
+static void* allocate(std::size_t size, std::align_val_t alignment) {
+    ++allocations;
+    auto align = static_cast<std::size_t>(alignment);
+    size = size == 0 ? align : (size + align - 1) / align * align;
+#ifdef _WIN32
+    void* p = _aligned_malloc(size, align);
+#else
+    void* p = std::aligned_alloc(align, size);
+#endif
+    if (p)
+        return p;
+    throw std::bad_alloc();
+}
+
+static void deallocate(void* p) noexcept { std::free(p); }
+
+static void deallocate(void* p, std::align_val_t) noexcept {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void* operator new(std::size_t size, std::align_val_t align) { return allocate(size, align); }
+void* operator new[](std::size_t size, std::align_val_t align) { return allocate(size, align); }
+
+void operator delete(void* p) noexcept { deallocate(p); }
+void operator delete[](void* p) noexcept { deallocate(p); }
+void operator delete(void* p, std::size_t) noexcept { deallocate(p); }
+void operator delete[](void* p, std::size_t) noexcept { deallocate(p); }
+void operator delete(void* p, std::align_val_t align) noexcept { deallocate(p, align); }
+void operator delete[](void* p, std::align_val_t align) noexcept { deallocate(p, align); }
+void operator delete(void* p, std::size_t, std::align_val_t align) noexcept { deallocate(p, align); }
+void operator delete[](void* p, std::size_t, std::align_val_t align) noexcept { deallocate(p, align); }
+
+
+enum class stage { cycle_removal, layering, crossing_reduction, positioning, routing, done };
+
+/**
+ * The state of the layout of a connected graph right before the given stage.
+ * The generated graphs are acyclic, so no reversed edges have to be tracked.
+ */
+struct pipeline {
+    graph g;
+    attributes attrs;
+    detail::subgraph sub;
+    detail::rev_edges rev;
+    std::optional<detail::hierarchy> h;
+    std::vector<node> nodes;
+    path_list paths;
+    detail::vertex_map<detail::bounding_box> boxes;
+
+    pipeline(const graph& source, stage next) : g(source), sub(g) {
+        if (next > stage::cycle_removal) {
+            rev = detail::dfs_removal().run(sub);
+        }
+        if (next > stage::layering) {
+            h.emplace(detail::network_simplex_layering().run(sub));
+            detail::add_dummy_nodes(*h);
+            init_nodes(source.size());
+        }
+        if (next > stage::crossing_reduction) {
+            detail::barycentric_heuristic().run(*h);
+        }
+        if (next > stage::positioning) {
+            detail::fast_and_simple_positioning(attrs, nodes, boxes, g).run(*h, { 0, 0 });
+        }
+        if (next > stage::routing) {
+            detail::router(nodes, paths, attrs).run(*h, rev);
+        }
+    }
+
+    void init_nodes(unsigned original) {
+        nodes.resize(g.size());
+        boxes.resize(g, { { 0, 0 }, { 0, 0 } });
+        for (vertex_t u = 0; u < g.size(); ++u) {
+            float r = u < original ? attrs.node_size : 0;
+            nodes[u] = node{ u, { 0, 0 }, r };
+            boxes[u] = { { 2*r, 2*r }, { r, r } };
+        }
+    }
+};
+
+struct result {
+    double ns = 0;      // time of one run
+    double allocs = 0;  // allocations of one run
+    int reps = 0;
+};
+
+const auto min_time = std::chrono::milliseconds(200);
+const auto max_wall_time = std::chrono::seconds(3);
+
+// keeps the results of the benchmarked functions alive
+static volatile long long sink = 0;
+
+/**
+ * Repeats <run> on fresh states from <prepare> until it ran for at least min_time in total.
+ * Only <run> is measured. Slow preparations stop the repetition after max_wall_time.
+ */
+template<typename State>
+result measure(std::function< std::unique_ptr<State>() > prepare, std::function< void(State&) > run) {
+    using clock = std::chrono::steady_clock;
+    auto wall_start = clock::now();
+    clock::duration total { 0 };
+    std::size_t allocs = 0;
+
+    result r;
+    do {
+        auto state = prepare();
+        std::size_t before = allocations;
+        auto start = clock::now();
+        run(*state);
+        total += clock::now() - start;
+        allocs += allocations - before;
+        ++r.reps;
+    } while (total < min_time && clock::now() - wall_start < max_wall_time);
+
+    r.ns = std::chrono::duration<double, std::nano>(total).count() / r.reps;
+    r.allocs = double(allocs) / r.reps;
+    return r;
+}
+
+struct benchmark {
+    std::string name;
+    std::function< result(const graph&) > run;
+};
+
+// benchmark of a stage of the layout running on a pipeline prepared up to it
+benchmark stage_benchmark(std::string name, stage next, std::function< void(pipeline&) > run) {
+    return { name, [next, run] (const graph& g) {
+        return measure<pipeline>([&g, next] { return std::make_unique<pipeline>(g, next); }, run);
+    } };
+}
+
+std::vector<benchmark> benchmarks() {
+    return {
+        stage_benchmark("cycle removal", stage::cycle_removal, [] (pipeline& p) {
+            p.rev = detail::dfs_removal().run(p.sub);
+        }),
+        stage_benchmark("network simplex", stage::layering, [] (pipeline& p) {
+            p.h.emplace(detail::network_simplex_layering().run(p.sub));
+        }),
+        stage_benchmark("count_crossings", stage::crossing_reduction, [] (pipeline& p) {
+            sink = sink + detail::count_crossings(*p.h);
+        }),
+        stage_benchmark("barycenter sweep", stage::crossing_reduction, [] (pipeline& p) {
+            detail::barycentric_heuristic(1, 7, false).run(*p.h);
+        }),
+        stage_benchmark("barycenter + transpose", stage::crossing_reduction, [] (pipeline& p) {
+            detail::barycentric_heuristic(1, 7, true).run(*p.h);
+        }),
+        stage_benchmark("brandes-kopf", stage::positioning, [] (pipeline& p) {
+            detail::fast_and_simple_positioning(p.attrs, p.nodes, p.boxes, p.g).run(*p.h, { 0, 0 });
+        }),
+        stage_benchmark("routing", stage::routing, [] (pipeline& p) {
+            detail::router(p.nodes, p.paths, p.attrs).run(*p.h, p.rev);
+        }),
+        { "svg emission", [] (const graph& g) {
+            return measure<sugiyama_layout>([&g] { return std::make_unique<sugiyama_layout>(g); }, [] (sugiyama_layout& l) {
+                drawing_options opts;
+                auto img = draw_svg_image(l, opts);
+                sink = sink + l.vertices().size();
+            });
+        } },
+    };
+}
+
+int main(int argc, char** argv) {
+    std::string filter = argc > 1 ? argv[1] : "";
+
+    const std::vector<unsigned> sizes = { 100, 500, 2000 };
+    const std::vector<double> densities = { 1.5, 3 };  // edges per vertex
+
+    std::printf("%-24s %8s %8s %6s %14s %12s %12s\n", "benchmark", "vertices", "edges", "reps", "ns/op", "ns/vertex", "allocs/op");
+    for (const auto& b : benchmarks()) {
+        if (b.name.find(filter) == std::string::npos)
+            continue;
+
+        dag_generator gen(11);
+        for (auto n : sizes) {
+            for (auto d : densities) {
+                unsigned m = n*d;
+                graph g = gen.generate_from_edges(n, m);
+                result r = b.run(g);
+                std::printf("%-24s %8u %8u %6d %14.0f %12.1f %12.1f\n", b.name.c_str(), n, m, r.reps, r.ns, r.ns/n, r.allocs);
+                std::fflush(stdout);
+            }
+        }
+    }
+}
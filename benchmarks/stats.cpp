@@ -272,7 +272,7 @@ void do_my_stat(const std::string& in, const std::string& log) {
 		graph g = parse(in + "/" + f, attr, opt);
 		sugiyama_layout l(g, attr);
 
-		count_stuff(l.edges(), l.vertices(), props);
+		count_stuff(l.edges().to_vector(), l.vertices(), props);
 	}
 
 	auto stats = get_stats(props);
@@ -302,9 +302,9 @@ int main(int argc, char **argv) {
 
 		sugiyama_layout l(g, at);
 
-		std::cout << "bends:     " << get_total_bends(l.edges()) << "\n";
-		std::cout << "length:    " << get_total_length(l.edges()) << "\n";
-		std::cout << "reversed:  " << get_total_reversed(l.edges()) << "\n";
-		std::cout << "crossings: " << get_total_cross(l.edges(), l.vertices()) << "\n";
+		std::cout << "bends:     " << get_total_bends(l.edges().to_vector()) << "\n";
+		std::cout << "length:    " << get_total_length(l.edges().to_vector()) << "\n";
+		std::cout << "reversed:  " << get_total_reversed(l.edges().to_vector()) << "\n";
+		std::cout << "crossings: " << get_total_cross(l.edges().to_vector(), l.vertices()) << "\n";
 	}*/
 }
\ No newline at end of file
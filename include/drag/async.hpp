@@ -0,0 +1,50 @@
+#pragma once
+
+#include <future>
+#include <memory>
+#include <thread>
+#include <utility>
+
+#include <drag/graph.hpp>
+#include <drag/layout.hpp>
+#include <drag/types.hpp>
+
+namespace drag {
+
+/**
+ * Lays out the graph <g> as a task of <executor>.
+ *
+ * The executor is called once with a callable taking no arguments, which computes the layout,
+ * for example to put it into the queue of a thread pool. Otherwise the same as layout_async(g, control).
+ */
+template<typename Executor>
+std::future< std::unique_ptr<sugiyama_layout> > layout_async(Executor&& executor, graph g, layout_control control = {}) {
+    using task_type = std::packaged_task< std::unique_ptr<sugiyama_layout>() >;
+
+    // the task is shared, since executors such as std::function may require a copyable callable
+    auto task = std::make_shared<task_type>([g = std::move(g), control = std::move(control)] () mutable {
+        return std::make_unique<sugiyama_layout>(std::move(g), std::move(control));
+    });
+    auto result = task->get_future();
+    executor([task] { (*task)(); });
+    return result;
+}
+
+/**
+ * Lays out the graph <g> on a new thread.
+ *
+ * The layout can be cancelled by control.token, the future then throws layout_cancelled.
+ * The token is checked between the stages and during the network simplex and crossing reduction,
+ * so an abandoned layout stops soon. control.progress is called on the thread computing the layout.
+ *
+ * The thread is detached, so dropping the future does not wait for the layout.
+ * The layout then still runs to its end unless control.token is cancelled.
+ *
+ * The layout is returned by a pointer, because it refers to its own members and cannot be moved.
+ */
+inline std::future< std::unique_ptr<sugiyama_layout> > layout_async(graph g, layout_control control = {}) {
+    auto detached = [] (auto task) { std::thread(std::move(task)).detach(); };
+    return layout_async(detached, std::move(g), std::move(control));
+}
+
+} // namespace drag
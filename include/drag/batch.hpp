@@ -0,0 +1,308 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include <drag/graph.hpp>
+#include <drag/layout.hpp>
+#include <drag/types.hpp>
+
+namespace drag {
+
+/**
+ * Threads which lay out graphs, each with its own sugiyama_layout.
+ *
+ * The threads are started once by the constructor and wait for work until the pool is destroyed.
+ * The layout of each thread is created for the first graph laid out on it and then reused by
+ * sugiyama_layout::relayout, so only the first graph pays for creating the modules and allocating
+ * their memory. The calling thread of run() is one of the threads of the pool.
+ */
+class layout_pool {
+    std::vector< std::optional<sugiyama_layout> > m_layouts;
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_run_mutex;  // held by run(), so that the pool runs one job at a time
+    std::mutex m_mutex;
+    std::condition_variable m_start;
+    std::condition_variable m_done;
+    const std::function<void(unsigned)>* m_job = nullptr;
+    std::vector<std::exception_ptr> m_errors;
+    size_t m_generation = 0;
+    unsigned m_running = 0;
+    bool m_stopped = false;
+
+public:
+    /**
+     * Creates a pool of <threads> threads, or one per hardware thread if <threads> is 0.
+     */
+    explicit layout_pool(unsigned threads = 0)
+        : m_layouts(threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency()))
+        , m_errors(m_layouts.size())
+    {
+        // the destructor does not run if starting a thread throws, so join the ones already started here
+        struct join_guard {
+            layout_pool* pool;
+            ~join_guard() { if (pool) pool->stop(); }
+        } guard{ this };
+
+        for (unsigned id = 1; id < size(); ++id) {
+            m_workers.emplace_back([this, id] { serve(id); });
+        }
+        guard.pool = nullptr;
+    }
+
+    ~layout_pool() { stop(); }
+
+    layout_pool(const layout_pool&) = delete;
+    layout_pool& operator=(const layout_pool&) = delete;
+
+    /**
+     * Get the number of threads, including the calling thread of run().
+     */
+    unsigned size() const { return static_cast<unsigned>(m_layouts.size()); }
+
+    /**
+     * Calls <job> with the ids 0 to size() - 1, each on a different thread, and waits until all of them return.
+     * The id 0 runs on the calling thread. If a call throws, the first exception is rethrown once all of them return.
+     */
+    void run(const std::function<void(unsigned)>& job) {
+        std::lock_guard<std::mutex> serial(m_run_mutex);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_job = &job;
+            m_running = static_cast<unsigned>(m_workers.size());
+            ++m_generation;
+        }
+        m_start.notify_all();
+
+        call(job, 0);
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_done.wait(lock, [this] { return m_running == 0; });
+            m_job = nullptr;
+        }
+
+        for (auto& e : m_errors) {
+            if (e) {
+                auto error = e;
+                std::fill(m_errors.begin(), m_errors.end(), nullptr);
+                std::rethrow_exception(error);
+            }
+        }
+    }
+
+    /**
+     * Lays out <g> with the layout of the thread <id> and returns it.
+     * Must be called only from the job passed to run(), with the id it was called with.
+     */
+    const sugiyama_layout& layout(unsigned id, const graph& g) {
+        auto& engine = m_layouts[id];
+        if (!engine) {
+            engine.emplace(g);
+            return *engine;
+        }
+        try {
+            engine->relayout(g);
+        } catch (...) {
+            // the layout may be left half updated, the next graph creates a new one
+            engine.reset();
+            throw;
+        }
+        return *engine;
+    }
+
+private:
+    void call(const std::function<void(unsigned)>& job, unsigned id) {
+        try {
+            job(id);
+        } catch (...) {
+            m_errors[id] = std::current_exception();
+        }
+    }
+
+    void serve(unsigned id) {
+        size_t generation = 0;
+        while (true) {
+            const std::function<void(unsigned)>* job;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_start.wait(lock, [&] { return m_stopped || m_generation != generation; });
+                if (m_stopped) {
+                    return;
+                }
+                generation = m_generation;
+                job = m_job;
+            }
+
+            call(*job, id);
+
+            bool last;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                last = --m_running == 0;
+            }
+            if (last) {
+                m_done.notify_one();
+            }
+        }
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopped = true;
+        }
+        m_start.notify_all();
+        for (auto& t : m_workers) {
+            t.join();
+        }
+    }
+};
+
+/**
+ * Layouts of many graphs computed by the threads of a layout_pool.
+ *
+ * The graphs are split into chunks of consecutive graphs which the threads take one by one.
+ * Each graph is laid out with the reused layout of its thread, see layout_pool.
+ *
+ * The results are stored in flat arrays in the order of the graphs: the nodes of all the layouts
+ * in one vector and the paths in one path_list. The nodes of the i-th layout start at first_vertex(i)
+ * and its paths at first_edge(i).
+ */
+class batch_layout {
+    std::vector<node> m_nodes;
+    path_list m_paths;
+    std::vector<size_t> m_first_vertex;  // one more than the number of graphs, the last one is the total
+    std::vector<size_t> m_first_edge;
+    std::vector<vec2> m_dimensions;
+
+    static constexpr size_t chunk_size = 16;
+
+    // the results of a chunk of graphs, filled by the thread which processed it
+    struct chunk {
+        std::vector<node> nodes;
+        path_list paths;
+    };
+
+public:
+    /**
+     * Lays out the <count> graphs starting at <graphs> on the threads of <pool>.
+     * If a layout throws, the first exception is rethrown once all threads finish.
+     */
+    batch_layout(layout_pool& pool, const graph* graphs, size_t count) {
+        compute(pool, graphs, count);
+    }
+
+    batch_layout(layout_pool& pool, const std::vector<graph>& graphs)
+        : batch_layout(pool, graphs.data(), graphs.size()) {}
+
+    /**
+     * Lays out the graphs on a pool of <threads> threads created for this batch only, see layout_pool.
+     * To lay out several batches, pass them the same pool, which keeps its threads and their layouts.
+     */
+    batch_layout(const graph* graphs, size_t count, unsigned threads = 0) {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        layout_pool pool(std::max<size_t>(1, std::min<size_t>(threads, (count + chunk_size - 1) / chunk_size)));
+        compute(pool, graphs, count);
+    }
+
+    batch_layout(const std::vector<graph>& graphs, unsigned threads = 0)
+        : batch_layout(graphs.data(), graphs.size(), threads) {}
+
+    /**
+     * Get the number of layouts.
+     */
+    size_t size() const { return m_dimensions.size(); }
+
+    /**
+     * Get the number of vertices and edges of the <i>-th layout.
+     */
+    size_t vertex_count(size_t i) const { return m_first_vertex[i + 1] - m_first_vertex[i]; }
+    size_t edge_count(size_t i) const { return m_first_edge[i + 1] - m_first_edge[i]; }
+
+    /**
+     * Get the vertex <u> and the <j>-th edge of the <i>-th layout.
+     */
+    const node& vertex(size_t i, vertex_t u) const { return m_nodes[m_first_vertex[i] + u]; }
+    path_ref edge(size_t i, size_t j) const { return m_paths[m_first_edge[i] + j]; }
+
+    float width(size_t i) const { return m_dimensions[i].x; }
+    float height(size_t i) const { return m_dimensions[i].y; }
+    vec2 dimensions(size_t i) const { return m_dimensions[i]; }
+
+    /**
+     * Get the position of the first vertex and edge of the <i>-th layout in the flat arrays.
+     */
+    size_t first_vertex(size_t i) const { return m_first_vertex[i]; }
+    size_t first_edge(size_t i) const { return m_first_edge[i]; }
+
+    /**
+     * Get the nodes and paths of all the layouts.
+     */
+    const std::vector<node>& vertices() const { return m_nodes; }
+    const path_list& edges() const { return m_paths; }
+
+private:
+    void compute(layout_pool& pool, const graph* graphs, size_t count) {
+        size_t chunk_count = (count + chunk_size - 1) / chunk_size;
+        std::vector<chunk> chunks(chunk_count);
+        std::vector<size_t> edge_counts(count);
+        m_dimensions.resize(count);
+
+        std::atomic<size_t> next_chunk { 0 };
+        pool.run([&] (unsigned id) {
+            try {
+                for (size_t c = next_chunk++; c < chunk_count; c = next_chunk++) {
+                    for (size_t i = c*chunk_size; i < std::min(count, (c + 1)*chunk_size); ++i) {
+                        const auto& layout = pool.layout(id, graphs[i]);
+                        const auto& nodes = layout.vertices();
+                        chunks[c].nodes.insert(chunks[c].nodes.end(), nodes.begin(), nodes.end());
+                        chunks[c].paths.append(layout.edges(), { 0, 0 });
+                        edge_counts[i] = layout.edges().size();
+                        m_dimensions[i] = layout.dimensions();
+                    }
+                }
+            } catch (...) {
+                // the other threads take no more chunks
+                next_chunk = chunk_count;
+                throw;
+            }
+        });
+
+        gather(graphs, count, chunks, edge_counts);
+    }
+
+    void gather(const graph* graphs, size_t count, std::vector<chunk>& chunks, const std::vector<size_t>& edge_counts) {
+        m_first_vertex.resize(count + 1);
+        m_first_edge.resize(count + 1);
+        m_first_vertex[0] = m_first_edge[0] = 0;
+        for (size_t i = 0; i < count; ++i) {
+            m_first_vertex[i + 1] = m_first_vertex[i] + graphs[i].size();
+            m_first_edge[i + 1] = m_first_edge[i] + edge_counts[i];
+        }
+
+        size_t point_count = 0;
+        for (const auto& c : chunks) {
+            point_count += c.paths.points().size();
+        }
+        m_nodes.reserve(m_first_vertex[count]);
+        m_paths.reserve(m_first_edge[count], point_count);
+
+        for (auto& c : chunks) {
+            m_nodes.insert(m_nodes.end(), c.nodes.begin(), c.nodes.end());
+            m_paths.append(c.paths, { 0, 0 });
+            c = chunk{};
+        }
+    }
+};
+
+} // namespace drag
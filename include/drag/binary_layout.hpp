@@ -0,0 +1,205 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <drag/types.hpp>
+#include <drag/vec2.hpp>
+#include <drag/layout.hpp>
+#include <drag/detail/mapped_file.hpp>
+
+namespace drag {
+
+/**
+ * Binary format of a finished layout, which can be read without parsing.
+ *
+ * The file consists of the header, the array of nodes, the table of paths and a single array
+ * of all the points of the paths. The points of a path are in the range starting at its
+ * first_point and ending at the first_point of the next path, or at the end of the array.
+ * All the values are 4 bytes long and stored in the byte order of the machine which wrote them.
+ */
+namespace binary {
+
+    const std::uint32_t magic = 0x4c475244;  // "DRGL"
+    const std::uint32_t version = 1;
+    const std::uint32_t byte_order = 0x01020304;
+
+    struct header {
+        std::uint32_t magic = binary::magic;
+        std::uint32_t version = binary::version;
+        std::uint32_t byte_order = binary::byte_order;
+        std::uint32_t node_count;
+        std::uint32_t path_count;
+        std::uint32_t point_count;
+        float width;
+        float height;
+    };
+
+    struct node_record {
+        std::uint32_t u;
+        float x, y;
+        float size;
+        float half_width, half_height;
+        std::uint32_t shape;
+    };
+
+    struct path_record {
+        std::uint32_t from, to;
+        std::uint32_t flags;
+        std::uint32_t first_point;
+    };
+
+    const std::uint32_t bidirectional = 1;
+    const std::uint32_t curved = 2;
+
+    static_assert(sizeof(header) == 32 && sizeof(node_record) == 28 && sizeof(path_record) == 16 && sizeof(vec2) == 8,
+                  "the records have to be packed");
+
+} // namespace binary
+
+
+/**
+ * Writes the layout in the binary format in a single pass.
+ */
+inline void write_layout(std::ostream& out, const std::vector<node>& nodes, const path_list& paths, vec2 dimensions) {
+    binary::header h;
+    h.node_count = nodes.size();
+    h.path_count = paths.size();
+    h.point_count = paths.points().size();
+    h.width = dimensions.x;
+    h.height = dimensions.y;
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+
+    for (const auto& n : nodes) {
+        binary::node_record r = { n.u, n.pos.x, n.pos.y, n.size, n.half_size.x, n.half_size.y, std::uint32_t(n.shape) };
+        out.write(reinterpret_cast<const char*>(&r), sizeof(r));
+    }
+
+    for (auto p : paths) {
+        std::uint32_t flags = (p.bidirectional ? binary::bidirectional : 0) | (p.curved ? binary::curved : 0);
+        std::uint32_t first = p.points.begin() - paths.points().data();
+        binary::path_record r = { p.from, p.to, flags, first };
+        out.write(reinterpret_cast<const char*>(&r), sizeof(r));
+    }
+
+    // the points of all the paths are already stored in the same order
+    out.write(reinterpret_cast<const char*>(paths.points().data()), paths.points().size()*sizeof(vec2));
+
+    if (!out) {
+        throw std::runtime_error("Failed to write the layout");
+    }
+}
+
+inline void write_layout(std::ostream& out, const sugiyama_layout& l) {
+    write_layout(out, l.vertices(), l.edges(), l.dimensions());
+}
+
+
+/**
+ * Read-only access to a layout in the binary format stored in memory.
+ *
+ * Nothing is copied or parsed, the data is accessed in place, so it has to outlive the view.
+ * The data has to be aligned to 4 bytes, which holds for memory returned by the allocators and for mapped files.
+ */
+class layout_view {
+    const char* m_data;
+    binary::header m_header;
+
+    const binary::path_record& path_at(size_t i) const {
+        return reinterpret_cast<const binary::path_record*>(m_data + paths_offset())[i];
+    }
+
+    size_t paths_offset() const { return sizeof(binary::header) + m_header.node_count*sizeof(binary::node_record); }
+    size_t points_offset() const { return paths_offset() + m_header.path_count*sizeof(binary::path_record); }
+
+public:
+    /**
+     * Checks that the data is a complete layout written on a machine with the same byte order.
+     */
+    layout_view(const void* data, size_t size) : m_data(static_cast<const char*>(data)) {
+        if (size < sizeof(binary::header)) {
+            throw std::invalid_argument("The data is too short to contain a layout");
+        }
+        std::memcpy(&m_header, m_data, sizeof(m_header));
+        if (m_header.magic != binary::magic) {
+            throw std::invalid_argument("The data does not contain a layout");
+        }
+        if (m_header.version != binary::version) {
+            throw std::invalid_argument("Unsupported version of the layout format: " + std::to_string(m_header.version));
+        }
+        if (m_header.byte_order != binary::byte_order) {
+            throw std::invalid_argument("The layout was written on a machine with a different byte order");
+        }
+        if (reinterpret_cast<std::uintptr_t>(m_data) % alignof(binary::node_record) != 0) {
+            throw std::invalid_argument("The layout data is not aligned");
+        }
+        if (size != points_offset() + size_t(m_header.point_count)*sizeof(vec2)) {
+            throw std::invalid_argument("The size of the data does not match the layout");
+        }
+    }
+
+    size_t node_count() const { return m_header.node_count; }
+    size_t path_count() const { return m_header.path_count; }
+
+    float width() const { return m_header.width; }
+    float height() const { return m_header.height; }
+    vec2 dimensions() const { return { m_header.width, m_header.height }; }
+
+    /**
+     * Returns the i-th node of the layout.
+     */
+    node vertex(size_t i) const {
+        const auto& r = reinterpret_cast<const binary::node_record*>(m_data + sizeof(binary::header))[i];
+        return node{ r.u, { r.x, r.y }, r.size, { r.half_width, r.half_height }, node_shape(r.shape) };
+    }
+
+    vertex_t from(size_t i) const { return path_at(i).from; }
+    vertex_t to(size_t i) const { return path_at(i).to; }
+    bool bidirectional(size_t i) const { return path_at(i).flags & binary::bidirectional; }
+    bool curved(size_t i) const { return path_at(i).flags & binary::curved; }
+
+    /**
+     * Returns the control points of the i-th path.
+     * Throws std::out_of_range if the table of paths is corrupted.
+     */
+    point_range points(size_t i) const {
+        std::uint32_t first = path_at(i).first_point;
+        std::uint32_t last = i + 1 < path_count() ? path_at(i + 1).first_point : m_header.point_count;
+        if (first > last || last > m_header.point_count) {
+            throw std::out_of_range("The points of the path " + std::to_string(i) + " are out of range");
+        }
+        const vec2* base = reinterpret_cast<const vec2*>(m_data + points_offset());
+        return { base + first, base + last };
+    }
+
+    /**
+     * Copies the i-th path out of the view.
+     */
+    path edge(size_t i) const {
+        auto pts = points(i);
+        return path{ from(i), to(i), std::vector<vec2>(pts.begin(), pts.end()), bidirectional(i), curved(i) };
+    }
+};
+
+
+/**
+ * A layout in the binary format mapped into memory from a file.
+ * Where mmap is not available, the file is read into memory instead.
+ */
+class mapped_layout {
+    detail::mapped_file m_file;
+
+public:
+    explicit mapped_layout(const std::string& filename) : m_file(filename) {}
+
+    /**
+     * Returns the view of the layout, which is valid as long as this object exists.
+     */
+    layout_view view() const { return layout_view(m_file.data(), m_file.size()); }
+};
+
+} // namespace drag
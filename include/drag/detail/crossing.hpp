@@ -4,10 +4,12 @@
 #include <iostream>
 #include <random>
 #include <cassert>
+#include <array>
+#include <cstdint>
+#include <cstring>
 
 #include "layering.hpp"
 #include "utils.hpp"
-#include "report.hpp"
 
 namespace drag {
 
@@ -43,6 +45,104 @@ inline int crossing_number(const hierarchy& h, vertex_t u, vertex_t v) {
     return count;
 }
 
+/**
+ * Positions of the neighbours of every vertex packed into two contiguous arrays
+ * (one for successors, one for predecessors). The positions of each vertex's
+ * neighbours are kept sorted, so the crossing number of two vertices
+ * can be computed by a linear merge instead of comparing all pairs of edges.
+ *
+ * The hierarchy has to be proper - all neighbours of a vertex lie on the adjacent layers.
+ */
+class neighbour_positions {
+    vertex_map<unsigned> out_start;
+    vertex_map<unsigned> in_start;
+    std::vector<int> out_pos;
+    std::vector<int> in_pos;
+
+public:
+    // rebuild the arrays from the current positions in <h>
+    void build(const hierarchy& h) {
+        out_start.resize(h.g);
+        in_start.resize(h.g);
+        out_pos.clear();
+        in_pos.clear();
+
+        for (auto u : h.g.vertices()) {
+            out_start[u] = out_pos.size();
+            for (auto v : h.g.out_neighbours(u)) {
+                out_pos.push_back(h.pos[v]);
+            }
+            std::sort(out_pos.begin() + out_start[u], out_pos.end());
+
+            in_start[u] = in_pos.size();
+            for (auto v : h.g.in_neighbours(u)) {
+                in_pos.push_back(h.pos[v]);
+            }
+            std::sort(in_pos.begin() + in_start[u], in_pos.end());
+        }
+    }
+
+    /**
+     * Counts the number of crossings between edges incident on <u> and <v>
+     * if <u> would be to the left of <v>. Same as crossing_number(h, u, v).
+     */
+    int crossing_number(const hierarchy& h, vertex_t u, vertex_t v) const {
+        return count_inversions(out_pos.data() + out_start[u], h.g.out_degree(u),
+                                out_pos.data() + out_start[v], h.g.out_degree(v)) +
+               count_inversions(in_pos.data() + in_start[u], h.g.in_deree(u),
+                                in_pos.data() + in_start[v], h.g.in_deree(v));
+    }
+
+    /**
+     * Updates the arrays after the neighbouring vertices <u> and <v> were swapped in <h>.
+     * Only the lists of the neighbours of <u> and <v> change.
+     */
+    void swap(const hierarchy& h, vertex_t u, vertex_t v) {
+        // <v> took the old position of <u> and vice versa
+        for (auto w : h.g.out_neighbours(u)) {
+            replace(in_pos.data() + in_start[w], h.g.in_deree(w), h.pos[v], h.pos[u]);
+        }
+        for (auto w : h.g.in_neighbours(u)) {
+            replace(out_pos.data() + out_start[w], h.g.out_degree(w), h.pos[v], h.pos[u]);
+        }
+        for (auto w : h.g.out_neighbours(v)) {
+            replace(in_pos.data() + in_start[w], h.g.in_deree(w), h.pos[u], h.pos[v]);
+        }
+        for (auto w : h.g.in_neighbours(v)) {
+            replace(out_pos.data() + out_start[w], h.g.out_degree(w), h.pos[u], h.pos[v]);
+        }
+    }
+
+private:
+    // number of pairs (a, b) with a from <lhs>, b from <rhs> and b < a; both arrays are sorted
+    static int count_inversions(const int* lhs, unsigned lhs_size, const int* rhs, unsigned rhs_size) {
+        int count = 0;
+        unsigned j = 0;
+        for (unsigned i = 0; i < lhs_size; ++i) {
+            while (j < rhs_size && rhs[j] < lhs[i]) {
+                ++j;
+            }
+            count += j;
+        }
+        return count;
+    }
+
+    // replace one occurence of <from> by <to> in a sorted array and restore the order
+    static void replace(int* data, unsigned size, int from, int to) {
+        unsigned i = std::find(data, data + size, from) - data;
+        assert(i < size);
+        data[i] = to;
+        while (i > 0 && data[i - 1] > data[i]) {
+            std::swap(data[i - 1], data[i]);
+            --i;
+        }
+        while (i + 1 < size && data[i + 1] < data[i]) {
+            std::swap(data[i + 1], data[i]);
+            ++i;
+        }
+    }
+};
+
 // counts the number of crossings between layers with index 'layer' and 'layer - 1'
 inline int count_layer_crossings(const hierarchy& h, int layer) {
     const std::vector<vertex_t>& upper = h.layers[layer - 1];
@@ -77,6 +177,48 @@ inline int count_crossings(const hierarchy& h) {
 }
 
 
+/**
+ * Maps a float to an unsigned integer ordered the same way as the floats.
+ * -0.0 and 0.0 get the same key. NaN is not supported.
+ */
+inline std::uint32_t sort_key(float value) {
+    value += 0.0f; // -0.0 becomes 0.0
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    // negative floats are ordered in reverse by their bits, positive ones after all negative ones
+    return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
+
+using sort_entry = std::pair<std::uint32_t, vertex_t>;
+
+/**
+ * Stable sort of <keys> by their first element using a radix sort by bytes.
+ * <tmp> is used as a buffer.
+ */
+inline void radix_sort(std::vector<sort_entry>& keys, std::vector<sort_entry>& tmp) {
+    if (keys.empty()) {
+        return;
+    }
+    tmp.resize(keys.size());
+    for (int shift = 0; shift < 32; shift += 8) {
+        std::array<unsigned, 257> count = { 0 };
+        for (const auto& k : keys) {
+            ++count[ ((k.first >> shift) & 0xff) + 1 ];
+        }
+        if (count[ ((keys[0].first >> shift) & 0xff) + 1 ] == keys.size()) {
+            continue; // all keys share this digit
+        }
+        for (int d = 0; d < 256; ++d) {
+            count[d + 1] += count[d];
+        }
+        for (const auto& k : keys) {
+            tmp[ count[ (k.first >> shift) & 0xff ]++ ] = k;
+        }
+        keys.swap(tmp);
+    }
+}
+
+
 // ----------------------------------------------------------------------------------------------
 // -------------------------------  CROSSING REDUCTION  -----------------------------------------
 // ----------------------------------------------------------------------------------------------
@@ -86,12 +228,19 @@ inline int count_crossings(const hierarchy& h) {
  * It reorders each layer of the hierarchy to avoid crossings.
  */
 struct crossing_reduction {
+    const cancellation_token* cancellation = nullptr;  /**< checked during long runs if set, which then throw layout_cancelled */
     
     /**
      * Executes the algorithm. 
      * It should leave h in a consistent state - ranking, layers and pos all agree with each other.
      */
     virtual void run(hierarchy& h) = 0;
+
+    /**
+     * Adds the counters of the last run to <stats>.
+     */
+    virtual void add_stats(layout_stats&) const {}
+
     virtual ~crossing_reduction() = default;
 };
 
@@ -110,22 +259,56 @@ class barycentric_heuristic : public crossing_reduction {
     vertex_map<int> best_order;
     int min_cross;
 
+    // counters of the last run
+    int base_cross = 0;
+    int passes = 0;
+
+    neighbour_positions neighbours;
+
+    // order of a previous layout used as a starting point
+    std::vector<float> initial_order;
+    float stability = 0;
+    vertex_map<int> initial_pos;
+
+    // buffers for reordering a single layer
+    static constexpr unsigned radix_threshold = 64;
+    std::vector<float> weights;
+    std::vector<sort_entry> keys;
+    std::vector<sort_entry> keys_tmp;
+
+    /**
+     * Modification counters of the layers. When a layer is processed, the counters of the layers
+     * its result depends on are remembered. If they did not change, processing the layer again
+     * would give the same result, so it is skipped.
+     */
+    using snapshot = std::array<unsigned, 3>;
+    std::vector<unsigned> modified;
+    std::vector<snapshot> down_seen;   // barycenter sweep from the top
+    std::vector<snapshot> up_seen;     // barycenter sweep from the bottom
+    std::vector<snapshot> trans_seen;  // transpose
+    std::vector<snapshot> cross_seen;  // crossings between the layer and the previous one
+    std::vector<int> layer_crossings;
+    bool tracking = true;
+    bool skip_unchanged = true;
+
 public:
     barycentric_heuristic() = default;
     barycentric_heuristic(int rnd_iters, int max_fails, bool do_transpose)
         : random_iters(rnd_iters), forgiveness(max_fails), trans(do_transpose) {}
 
-    void run(hierarchy& h) override {
-#ifdef REPORTING
-        report::base = min_cross;
-        report::random_runs = max_iters;
-        report::forgivness = forgiveness;
-        report::transpose = trans;
-        report::random_final.clear();
-        report::iters = 0;
-#endif
+    /**
+     * Starts from the order given by <order> instead of a barycentric sweep over arbitrary order.
+     * Vertices with identifiers outside of <order> are placed according to their neighbours.
+     * The barycenters are pulled towards the initial positions with weight <stability>.
+     */
+    barycentric_heuristic(std::vector<float> order, float stability)
+        : initial_order(std::move(order)), stability(stability) {}
 
-        min_cross = init_order(h);
+    void run(hierarchy& h) override {
+        reset_tracking(h);
+        min_cross = initial_order.empty() ? init_order(h) : seed_order(h);
+        base_cross = min_cross;
+        passes = 0;
         best_order = h.pos;
         int base = min_cross;
         for (int i = 0; i < random_iters; ++i) {
@@ -136,6 +319,7 @@ public:
                     std::shuffle(l.begin(), l.end(), mt);
                 }
                 h.update_pos();
+                invalidate_layers();
                 base = init_order(h);
             }
         }
@@ -144,15 +328,78 @@ public:
             h.layer(u)[ best_order[u] ] = u;
         }
         h.update_pos();
+    }
 
-#ifdef REPORTING
-        report::final = min_cross;
-#endif
+    /**
+     * If <value> is false, all layers are processed in every sweep even if they would not change.
+     * The result is the same, it is used to test the skipping.
+     */
+    void set_skip_unchanged(bool value) { skip_unchanged = value; }
+
+    void add_stats(layout_stats& stats) const override {
+        stats.initial_crossings += base_cross;
+        stats.final_crossings += min_cross;
+        stats.crossing_passes += passes;
     }
 
     int init_order(hierarchy& h) {
         barycenter(h, 0);
-        return count_crossings(h);
+        return crossings(h);
+    }
+
+    // orders the layers according to the initial order, returns the number of crossings
+    int seed_order(hierarchy& h) {
+        vertex_map<float> seed_keys(h.g, 0);
+        vertex_map<bool> known(h.g, false);
+
+        float max_key = 0;
+        for (auto u : h.g.vertices()) {
+            if (!h.g.is_dummy(u) && u < initial_order.size()) {
+                seed_keys[u] = initial_order[u];
+                known.set(u, true);
+                max_key = std::max(max_key, seed_keys[u]);
+            }
+        }
+
+        // dummy and new vertices get the average key of their already placed neighbours
+        auto propagate = [&] (int layer, bool downward) {
+            for (auto u : h.layers[layer]) {
+                if (known.at(u))
+                    continue;
+                float sum = 0;
+                int count = 0;
+                for (auto v : downward ? h.g.in_neighbours(u) : h.g.out_neighbours(u)) {
+                    if (known.at(v)) {
+                        sum += seed_keys[v];
+                        count++;
+                    }
+                }
+                if (count > 0) {
+                    seed_keys[u] = sum / count;
+                    known.set(u, true);
+                }
+            }
+        };
+        for (int i = 0; i < h.size(); ++i) {
+            propagate(i, true);
+        }
+        for (int i = h.size() - 1; i >= 0; --i) {
+            propagate(i, false);
+        }
+
+        for (int i = 0; i < h.size(); ++i) {
+            auto& layer = h.layers[i];
+            std::stable_sort(layer.begin(), layer.end(), [&] (vertex_t u, vertex_t v) {
+                float ku = known.at(u) ? seed_keys[u] : max_key + 1;
+                float kv = known.at(v) ? seed_keys[v] : max_key + 1;
+                return ku < kv;
+            });
+            h.update_pos(i);
+        }
+
+        initial_pos = h.pos;
+        invalidate_layers();
+        return crossings(h);
     }
 
 private:
@@ -161,7 +408,11 @@ private:
         auto local_order = h.pos;
         int fails = 0;
 
-        for (int i = 0; ; ++i) {
+        int i = 0;
+        for ( ; ; ++i) {
+            if (cancellation) {
+                cancellation->throw_if_cancelled();
+            }
 
             barycenter(h, i);   
 
@@ -173,7 +424,7 @@ private:
 #endif
             }
 
-            int cross = count_crossings(h);
+            int cross = crossings(h);
             //std::cout << cross << "\n";
             if (cross < local_min) {
                 fails = 0;
@@ -193,72 +444,162 @@ private:
             min_cross = local_min;
         }
 
-#ifdef REPORTING
-        report::iters += i;
-        report::random_final.push_back(local_min);
-#endif
+        passes += i + 1;
     }
 
     void barycenter(hierarchy& h, int i) {
-        vertex_map<float> weights(h.g);
-
         if (i % 2 == 0) { // top to bottom
             for (int j = 1; j < h.size(); ++j) {
-                reorder_layer(h, weights, j, true);
+                reorder_layer(h, j, true);
             }
         } else { // from bottom up
             for (int j = h.size() - 2; j >= 0; --j) {
-                reorder_layer(h, weights, j, false);
+                reorder_layer(h, j, false);
+            }
+        }
+    }
+
+    void reset_tracking(const hierarchy& h) {
+        modified.assign(h.size(), 1);
+        down_seen.assign(h.size(), { 0, 0, 0 });
+        up_seen.assign(h.size(), { 0, 0, 0 });
+        trans_seen.assign(h.size(), { 0, 0, 0 });
+        cross_seen.assign(h.size(), { 0, 0, 0 });
+        layer_crossings.assign(h.size(), 0);
+
+        // if there are long edges, the layers depend on more than their neighbours
+        tracking = skip_unchanged;
+        for (auto u : h.g.vertices()) {
+            for (auto v : h.g.out_neighbours(u)) {
+                tracking = tracking && h.span(u, v) == 1;
+            }
+        }
+    }
+
+    // marks all layers as modified
+    void invalidate_layers() {
+        for (auto& m : modified) {
+            ++m;
+        }
+    }
+
+    // the counters of the layer <i> and its neighbouring layers
+    snapshot current(int i, bool prev, bool next) const {
+        return { prev && i > 0 ? modified[i - 1] : 0,
+                 modified[i],
+                 next && i + 1 < modified.size() ? modified[i + 1] : 0 };
+    }
+
+    // true if <now> equals the remembered counters <seen>, otherwise remembers <now>
+    bool unchanged(snapshot& seen, snapshot now) const {
+        if (tracking && seen == now) {
+            return true;
+        }
+        seen = now;
+        return false;
+    }
+
+    // counts the total number of crossings, only the layers that changed are recounted
+    int crossings(const hierarchy& h) {
+        int count = 0;
+        for (int i = 1; i < h.size(); ++i) {
+            if (!unchanged(cross_seen[i], current(i, true, false))) {
+                layer_crossings[i] = count_layer_crossings(h, i);
             }
+            count += layer_crossings[i];
         }
+        return count;
     }
 
     // reorders vertices on a layer 'i' based on their weights
-    void reorder_layer(hierarchy& h, vertex_map<float>& weights, int i, bool downward) {
+    void reorder_layer(hierarchy& h, int i, bool downward) {
+        auto& seen = downward ? down_seen[i] : up_seen[i];
+        if (unchanged(seen, current(i, downward, !downward))) {
+            return;
+        }
+
         auto& layer = h.layers[i];
-        for (vertex_t u : layer) {
-                weights[u] = weight( h.pos, u, downward ? h.g.in_neighbours(u) : h.g.out_neighbours(u) );
+        layer_weights(h, layer, downward);
+
+        keys.resize(layer.size());
+        for (int k = 0; k < layer.size(); ++k) {
+            assert(h.ranking[layer[k]] == i);
+            keys[k] = { sort_key(weights[k]), layer[k] };
         }
-        std::sort(layer.begin(), layer.end(), [&weights,i,&h] (const auto& u, const auto& v) {
-            assert(h.ranking[u] == i);
-            assert(h.ranking[v] == i);
-            return weights[u] < weights[v];
-        });
+        sort_keys();
 
-        h.update_pos();
+        bool changed = false;
+        for (int k = 0; k < layer.size(); ++k) {
+            changed = changed || layer[k] != keys[k].second;
+            layer[k] = keys[k].second;
+        }
+        if (changed) {
+            h.update_pos(i);
+            ++modified[i];
+        }
     }
 
-    // calculates the weight of vertex as an average of the positions of its neighbour
-    template<typename T>
-    float weight(const vertex_map<int>& positions, vertex_t u, const T& neighbours) {
-        unsigned count = 0;
-        unsigned sum = 0;
-        for (auto v : neighbours) {
-            sum += positions[v];
-            count++;
+    /**
+     * Calculates the weights of all vertices on a layer in one pass. 
+     * The weight of a vertex is the average of the positions of its neighbours
+     * on the previous (<downward>) or the next layer.
+     * The weight of <layer[k]> is stored in <weights[k]>.
+     */
+    void layer_weights(const hierarchy& h, const std::vector<vertex_t>& layer, bool downward) {
+        weights.resize(layer.size());
+        for (int k = 0; k < layer.size(); ++k) {
+            vertex_t u = layer[k];
+            const auto& neighbours = downward ? h.g.in_neighbours(u) : h.g.out_neighbours(u);
+
+            unsigned sum = 0;
+            for (auto v : neighbours) {
+                sum += h.pos[v];
+            }
+            weights[k] = neighbours.empty() ? h.pos[u] : sum / (float)neighbours.size();
+            if (stability > 0 && !initial_order.empty()) {
+                weights[k] = (weights[k] + stability*initial_pos[u]) / (1 + stability);
+            }
         }
-        if (count == 0) {
-            return positions[u];
+    }
+
+    /**
+     * Stable sort of <keys> by the weight.
+     * Long layers are sorted by a radix sort, short ones by a comparison sort.
+     */
+    void sort_keys() {
+        if (keys.size() < radix_threshold) {
+            std::stable_sort(keys.begin(), keys.end(), [] (const auto& a, const auto& b) {
+                return a.first < b.first;
+            });
+            return;
         }
-        return sum / (float)count;
+        radix_sort(keys, keys_tmp);
     }
 
     // Heuristic for reducing crossings which repeatedly attempts to swap all ajacent vertices.
     void transpose(hierarchy& h) {
+        neighbours.build(h);
         bool improved = true;
         int k = 0;
         while (improved) {
             improved = false;
             
-            for (auto& layer : h.layers) {
+            for (int l = 0; l < h.size(); ++l) {
+                if (unchanged(trans_seen[l], current(l, true, true))) {
+                    continue;
+                }
+
+                auto& layer = h.layers[l];
                 for (int i = 0; i < layer.size() - 1; ++i) {
-                    int old = crossing_number(h, layer[i], layer[i + 1]);
-                    int next = crossing_number(h, layer[i + 1], layer[i]);
+                    int old = neighbours.crossing_number(h, layer[i], layer[i + 1]);
+                    int next = neighbours.crossing_number(h, layer[i + 1], layer[i]);
                     int diff =  old - next;
                     
                     if ( old > next ) {
                         improved = true;
                         h.swap(layer[i], layer[i + 1]);
+                        neighbours.swap(h, layer[i], layer[i + 1]);
+                        ++modified[l];
                     }
                 }
             }
@@ -269,18 +610,20 @@ private:
     void fast_transpose(hierarchy& h) {
         //std::cout << h << "\n";
         vertex_map<bool> eligible(h.g, true);
+        neighbours.build(h);
 
         bool improved = true;
         int iters = 0;
         while (improved) {
             iters++;
             improved = false;
-            for (auto& layer : h.layers) {
+            for (int l = 0; l < h.size(); ++l) {
+                auto& layer = h.layers[l];
                 assert(layer.size() >= 1);
                 for (int i = 0; i < layer.size() - 1; ++i) {
                     if (eligible.at( layer[i] )) {
-                        int old = crossing_number(h, layer[i], layer[i + 1]);
-                        int next = crossing_number(h, layer[i + 1], layer[i]);
+                        int old = neighbours.crossing_number(h, layer[i], layer[i + 1]);
+                        int next = neighbours.crossing_number(h, layer[i + 1], layer[i]);
                         int diff =  old - next;
                     
                         if ( diff > 0 ) {
@@ -289,6 +632,8 @@ private:
                             improved = true;
                             //int before = count_crossings(h);
                             h.swap(layer[i], layer[i + 1]);
+                            neighbours.swap(h, layer[i], layer[i + 1]);
+                            ++modified[l];
                             //assert( (before - diff == count_crossings(h)) );
                             //min_cross -= diff;
                             if (i > 0) eligible.set( layer[i - 1], true );
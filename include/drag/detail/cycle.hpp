@@ -48,6 +48,14 @@ public:
         vertex_map<state> marks(g, state::unvisited);
         rev_edges reversed_edges;
 
+        // the loops are tagged by the graph, removing them first keeps them out of the search
+        for (auto u : g.vertices()) {
+            if (g.has_loop(u)) {
+                reversed_edges.loops.push_back(u);
+                g.remove_edge(u, u);
+            }
+        }
+
         // find cycles
         for (auto u : g.vertices()) {
             if (marks[u] == state::unvisited) {
@@ -69,10 +77,6 @@ public:
             }
         }
 
-        for (auto u : reversed_edges.loops) {
-            g.remove_edge(u, u);
-        }
-
         return reversed_edges;
     }
 
@@ -81,9 +85,7 @@ private:
         marks[u] = state::in_progress;
         
         for (auto v : g.out_neighbours(u)) {
-            if (u == v) { // a loop
-                reversed_edges.loops.push_back(u);
-            } else if (marks[v] == state::in_progress) { // there is a cycle
+            if (marks[v] == state::in_progress) { // there is a cycle
                 if (g.has_edge(v, u)) { // two-cycle
                     //std::cout << edge{u,v} << "\n";
                     reversed_edges.collapsed.insert({ v, u });
@@ -7,6 +7,8 @@
 
 #include <random>
 #include <algorithm>
+#include <unordered_set>
+#include <cstdint>
 #include <assert.h>
 
 namespace drag {
@@ -83,9 +85,177 @@ public:
         return g;
     }
 
+    /**
+     * A path through <vertex_count> vertices with the remaining edges skipping at most <max_skip> vertices forward.
+     */
+    drag::graph generate_chain(size_t vertex_count, size_t edge_count, size_t max_skip = 4) {
+        drag::graph g = empty_graph(vertex_count);
+        if (vertex_count < 2)
+            return g;
+        edge_filter edges(g);
+        for (size_t u = 0; u + 1 < vertex_count; ++u) {
+            edges.add(u, u + 1);
+        }
+
+        std::uniform_int_distribution<size_t> from(0, vertex_count - 1);
+        std::uniform_int_distribution<size_t> skip(2, max_skip + 1);
+        while (edges.count < edge_count && edges.attempts < 4*edge_count) {
+            auto u = from(m_engine);
+            auto v = u + skip(m_engine);
+            if (v < vertex_count) {
+                edges.add(u, v);
+            }
+        }
+        return g;
+    }
+
+    /**
+     * A rooted tree in which each vertex has <fan_out> children, only the last vertices have fewer.
+     */
+    drag::graph generate_tree(size_t vertex_count, size_t fan_out) {
+        drag::graph g = empty_graph(vertex_count);
+        for (size_t u = 1; u < vertex_count; ++u) {
+            g.add_edge((u - 1)/fan_out, u);
+        }
+        return g;
+    }
+
+    /**
+     * Layers of <width> vertices with the edges going only between neighbouring layers.
+     * Each vertex below the first layer has at least one predecessor.
+     */
+    drag::graph generate_layered(size_t vertex_count, size_t edge_count, size_t width) {
+        drag::graph g = empty_graph(vertex_count);
+        edge_filter edges(g);
+        auto layer_start = [width] (size_t u) { return u - u % width; };
+
+        for (size_t v = width; v < vertex_count; ++v) {
+            std::uniform_int_distribution<size_t> pred(layer_start(v) - width, layer_start(v) - 1);
+            edges.add(pred(m_engine), v);
+        }
+
+        std::uniform_int_distribution<size_t> from(0, vertex_count - 1);
+        while (edges.count < edge_count && edges.attempts < 4*edge_count) {
+            auto u = from(m_engine);
+            auto start = layer_start(u) + width;
+            if (start >= vertex_count)
+                continue;
+            std::uniform_int_distribution<size_t> to(start, std::min(start + width, vertex_count) - 1);
+            edges.add(u, to(m_engine));
+        }
+        return g;
+    }
+
+    /**
+     * A graph grown by preferential attachment, so the degrees follow a power law.
+     * Each new vertex gets edges from the previous vertices chosen with a probability proportional to their degree.
+     */
+    drag::graph generate_power_law(size_t vertex_count, size_t edge_count) {
+        drag::graph g = empty_graph(vertex_count);
+        edge_filter edges(g);
+
+        // each vertex appears once for each of its edges, and once more so that the new vertices can be chosen
+        std::vector<size_t> endpoints;
+        endpoints.reserve(2*edge_count + vertex_count);
+        endpoints.push_back(0);
+
+        double per_vertex = vertex_count > 1 ? double(edge_count)/(vertex_count - 1) : 0;
+        double owed = 0;
+        for (size_t v = 1; v < vertex_count; ++v) {
+            owed += per_vertex;
+            size_t k = std::max<size_t>(1, owed);
+            owed -= k;
+            for (size_t i = 0; i < k; ++i) {
+                std::uniform_int_distribution<size_t> pick(0, endpoints.size() - 1);
+                auto u = endpoints[pick(m_engine)];
+                if (edges.add(u, v)) {
+                    endpoints.push_back(u);
+                    endpoints.push_back(v);
+                }
+            }
+            endpoints.push_back(v);
+        }
+        return g;
+    }
+
+    /**
+     * <count> separate random DAGs, each with <vertex_count> vertices and <edge_count> edges.
+     */
+    drag::graph generate_components(size_t count, size_t vertex_count, size_t edge_count) {
+        drag::graph g = empty_graph(count*vertex_count);
+        edge_filter edges(g);
+
+        std::uniform_int_distribution<size_t> local(0, vertex_count - 1);
+        for (size_t c = 0; c < count; ++c) {
+            size_t first = c*vertex_count;
+            size_t target = edges.count + edge_count;
+            for (size_t v = 1; v < vertex_count; ++v) {
+                std::uniform_int_distribution<size_t> pred(0, v - 1);
+                edges.add(first + pred(m_engine), first + v);
+            }
+            for (size_t tries = 0; edges.count < target && tries < 4*edge_count; ++tries) {
+                auto u = local(m_engine), v = local(m_engine);
+                if (u != v) {
+                    edges.add(first + std::min(u, v), first + std::max(u, v));
+                }
+            }
+        }
+        return g;
+    }
+
+    /**
+     * A path through all the vertices and random edges between the vertices, half of which go backwards along the path.
+     * The graph has a lot of cycles.
+     */
+    drag::graph generate_cyclic(size_t vertex_count, size_t edge_count) {
+        drag::graph g = empty_graph(vertex_count);
+        if (vertex_count < 2)
+            return g;
+        edge_filter edges(g);
+        for (size_t u = 0; u + 1 < vertex_count; ++u) {
+            edges.add(u, u + 1);
+        }
+
+        std::uniform_int_distribution<size_t> vertex(0, vertex_count - 1);
+        while (edges.count < edge_count && edges.attempts < 4*edge_count) {
+            auto u = vertex(m_engine), v = vertex(m_engine);
+            if (u != v) {
+                edges.add(u, v);
+            }
+        }
+        return g;
+    }
+
 private:
     std::mt19937 m_engine;
 
+    // adds the edges to the graph, unless they were already added
+    struct edge_filter {
+        drag::graph& g;
+        std::unordered_set<std::uint64_t> seen;
+        size_t count = 0;
+        size_t attempts = 0;
+
+        edge_filter(drag::graph& g) : g(g) {}
+
+        bool add(size_t u, size_t v) {
+            ++attempts;
+            if (!seen.insert((std::uint64_t(u) << 32) | v).second)
+                return false;
+            g.add_edge(u, v);
+            ++count;
+            return true;
+        }
+    };
+
+    drag::graph empty_graph(size_t vertex_count) {
+        drag::graph g;
+        for (size_t i = 0; i < vertex_count; ++i) {
+            g.add_node();
+        }
+        return g;
+    }
+
     std::vector<std::pair<size_t, size_t>> generate_tree_edges(size_t n) {
         if (n <= 1) return {};
         if (n == 2) return { std::pair(0, 1) };
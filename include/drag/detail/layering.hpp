@@ -6,9 +6,11 @@
 #include <utility>
 #include <optional>
 #include <cassert>
+#include <map>
+#include <string>
 
 #include <drag/detail/subgraph.hpp>
-#include <drag/detail/report.hpp>
+#include <drag/detail/cycle.hpp>
 
 namespace drag {
 
@@ -54,6 +56,14 @@ struct hierarchy {
         }
     }
 
+    // recalculate positions of the vertices on a single layer
+    void update_pos(int layer_idx) {
+        int i = 0;
+        for (auto u : layers[layer_idx]) {
+            pos[u] = i++;
+        }
+    }
+
     // get the successor/predecessor of u on its layer
     vertex_t next(vertex_t u) const { return layers[ ranking[u] ][ pos[u] + 1 ]; }
     vertex_t prev(vertex_t u) const { return layers[ ranking[u] ][ pos[u] - 1 ]; }
@@ -115,6 +125,20 @@ struct long_edge {
     long_edge(edge orig, std::vector<vertex_t> path) : orig(orig), path(std::move(path)) {}
 };
 
+/**
+ * Adds a new dummy vertex to the end of the layer <layer>.
+ */
+inline vertex_t add_dummy(hierarchy& h, int layer) {
+    vertex_t t = h.g.add_dummy();
+
+    h.ranking.add_vertex(t);
+    h.ranking[t] = layer;
+    h.layers[layer].push_back(t);
+    h.pos.insert( t, h.layers[layer].size() - 1 );
+
+    return t;
+}
+
 /**
  * Splits all edges that span across more than one layer in the provided hierarchy
  * into segments that each span across just one layer.
@@ -142,13 +166,7 @@ inline std::vector< long_edge > add_dummy_nodes(hierarchy& h) {
 
         vertex_t s = orig.from;
         for (int i = 0; i < span - 1; ++i) {
-            vertex_t t = h.g.add_dummy();
-
-            h.ranking.add_vertex(t);
-            h.ranking[t] = h.ranking[s] + 1;
-            h.layers[ h.ranking[t] ].push_back(t);
-            h.pos.insert( t, h.layers[ h.ranking[t] ].size() - 1 );
-
+            vertex_t t = add_dummy(h, h.ranking[s] + 1);
             h.g.add_edge(s, t);
             path.push_back(t);
 
@@ -162,6 +180,86 @@ inline std::vector< long_edge > add_dummy_nodes(hierarchy& h) {
     return split_edges;
 }
 
+/**
+ * Merges the long edges leaving the same vertex into a single chain of dummy vertices,
+ * which branches off to each of the targets from the layer right above it.
+ * Then the remaining long edges entering the same vertex are merged in the same way.
+ * The reversed edges are left as they are.
+ *
+ * Afterwards the dummy vertices of the merged chains can have several in or out neighbours.
+ * The edges which were not merged still have to be split by add_dummy_nodes.
+ */
+inline void concentrate_edges(hierarchy& h, const rev_edges& rev) {
+    auto mergeable = [&h, &rev] (vertex_t u, vertex_t v) {
+        return h.span(u, v) > 1 && !rev.reversed.contains(u, v) && !rev.collapsed.contains(u, v);
+    };
+
+    std::vector<vertex_t> ends;
+    std::vector<vertex_t> chain;
+    unsigned original_count = h.g.size();
+
+    // fan-out
+    for (unsigned i = 0; i < original_count; ++i) {
+        vertex_t u = h.g.vertex(i);
+        ends.clear();
+        for (auto v : h.g.out_neighbours(u)) {
+            if (mergeable(u, v)) ends.push_back(v);
+        }
+        if (ends.size() < 2)
+            continue;
+
+        // chain[j] is the dummy vertex in the layer ranking[u] + 1 + j
+        int last = 0;
+        for (auto v : ends) {
+            last = std::max(last, h.ranking[v] - 1);
+        }
+        chain.clear();
+        vertex_t s = u;
+        for (int layer = h.ranking[u] + 1; layer <= last; ++layer) {
+            vertex_t t = add_dummy(h, layer);
+            h.g.add_edge(s, t);
+            chain.push_back(t);
+            s = t;
+        }
+
+        for (auto v : ends) {
+            h.g.remove_edge(u, v);
+            h.g.add_edge(chain[ h.ranking[v] - h.ranking[u] - 2 ], v);
+        }
+    }
+
+    // fan-in
+    for (unsigned i = 0; i < original_count; ++i) {
+        vertex_t v = h.g.vertex(i);
+        ends.clear();
+        for (auto u : h.g.in_neighbours(v)) {
+            if (!h.g.is_dummy(u) && mergeable(u, v)) ends.push_back(u);
+        }
+        if (ends.size() < 2)
+            continue;
+
+        // chain[j] is the dummy vertex in the layer first + j
+        int first = h.ranking[v];
+        for (auto u : ends) {
+            first = std::min(first, h.ranking[u] + 1);
+        }
+        chain.clear();
+        for (int layer = first; layer < h.ranking[v]; ++layer) {
+            vertex_t t = add_dummy(h, layer);
+            if (!chain.empty()) {
+                h.g.add_edge(chain.back(), t);
+            }
+            chain.push_back(t);
+        }
+        h.g.add_edge(chain.back(), v);
+
+        for (auto u : ends) {
+            h.g.remove_edge(u, v);
+            h.g.add_edge(u, chain[ h.ranking[u] + 1 - first ]);
+        }
+    }
+}
+
 // --------------------------------------------------------------------------------------
 // ------------------------------  LAYERING  --------------------------------------------
 // --------------------------------------------------------------------------------------
@@ -171,7 +269,15 @@ inline std::vector< long_edge > add_dummy_nodes(hierarchy& h) {
  * Interface for an algorithm which constructs a hierarchy for a given graph.
  */
 struct layering {
+    const cancellation_token* cancellation = nullptr;  /**< checked during long runs if set, which then throw layout_cancelled */
+
     virtual hierarchy run(detail::subgraph&) = 0;
+
+    /**
+     * Adds the counters of the last run to <stats>.
+     */
+    virtual void add_stats(layout_stats&) const {}
+
     virtual ~layering() = default;
 };
 
@@ -369,28 +475,51 @@ struct tight_tree {
  */
 class network_simplex_layering : public layering {
     tight_tree tree;
+    std::vector<int> initial_ranks;
+    int iterations = 0;  // pivots of the last run
+    std::map<vertex_t, std::string>* labels = nullptr;  // where to record the debug labels of the vertices, if anywhere
+    bool optimize = true;  // if false, the longest path ranking is not optimized
 
 public:
+    network_simplex_layering() = default;
+
+    /**
+     * Starts the optimization from a ranking close to <ranks> instead of the longest path ranking.
+     * If the ranking is close to the optimal one, only a few iterations are needed.
+     * Vertices with identifiers outside of <ranks> are ranked as low as possible.
+     */
+    network_simplex_layering(std::vector<int> ranks) : initial_ranks(std::move(ranks)) {}
+
+    void add_stats(layout_stats& stats) const override {
+        stats.simplex_iterations += iterations;
+    }
+
+    /**
+     * Records the parent and the cut value of each vertex in the final spanning tree into <out>.
+     * Used by the layout_debug of a layout.
+     */
+    void record_labels(std::map<vertex_t, std::string>* out) { labels = out; }
+
+    /**
+     * If <value> is false, only the initial longest path ranking is computed, without the network simplex.
+     * Used for quick previews of a layout.
+     */
+    void set_optimize(bool value) { optimize = value; }
 
     hierarchy run(subgraph& g) override {
+        iterations = 0;
         if (g.size() == 0) {
             return hierarchy(g);
         }
-        auto h = init_hierarchy(g);
+        auto h = initial_ranks.empty() ? init_hierarchy(g) : seeded_hierarchy(g);
 
         /*for (auto u : g.vertices()) {
             std::cout << u << ": " << h.ranking[u] << "\n";
         }*/
 
-        init_tree(h);
-        init_cut_values();
-
-        /*for (auto u : g.vertices()) {
-            std::cout << u << ": " << h.ranking[u] << "\n";
+        if (optimize) {
+            optimize_ranking(g, h);
         }
-        std::cout << tree << "\n";*/
-
-        optimize_edge_length(g, h);
 
         //std::cout << "optimized\n";
 
@@ -404,10 +533,12 @@ public:
 
         optimize_edge_length(g, h);*/
 
-        for (int i = 0; i < g.size(); ++i) {
-            debug_labels[i] = std::to_string(i) + "(" +
-                        std::to_string(tree.node(i).parent ? *tree.node(i).parent : -1) + ", " +
-                        std::to_string(tree.node(i).cut_value) + ")";
+        if (labels && optimize) {
+            for (auto u : g.vertices()) {
+                (*labels)[u] = std::to_string(u) + "(" +
+                            std::to_string(tree.node(u).parent ? int(*tree.node(u).parent) : -1) + ", " +
+                            std::to_string(tree.node(u).cut_value) + ")";
+            }
         }
 
         int min = std::numeric_limits<int>::max();
@@ -442,7 +573,11 @@ public:
     }
 
 private:
-
+    void optimize_ranking(subgraph& g, hierarchy& h) {
+        init_tree(h);
+        init_cut_values();
+        optimize_edge_length(g, h);
+    }
 
     /**
      * Assignes each vertex a layer, such that each edge goes from a lower layer to higher one
@@ -485,6 +620,45 @@ private:
         return h;
     }
 
+    /**
+     * Assignes each vertex a layer at least as high as its initial rank, such that each edge 
+     * goes from a lower layer to higher one. Vertices are processed in a topological order
+     * and pushed down only as much as their predecessors require.
+     * 
+     * @param g the graph whose vertices are to be assigned to layers
+     * @return resulting hierarchy, only the ranking of nodes is defined, layers and pos are undefined
+     */
+    hierarchy seeded_hierarchy(detail::subgraph& g) {
+        hierarchy h(g, -1);
+        vertex_map<int> in_degree(g, 0);
+        std::vector<vertex_t> to_rank;
+
+        for (auto u : g.vertices()) {
+            in_degree[u] = g.in_neighbours(u).size();
+            if (in_degree[u] == 0) {
+                to_rank.push_back(u);
+            }
+        }
+
+        while (!to_rank.empty()) {
+            vertex_t u = to_rank.back();
+            to_rank.pop_back();
+
+            int rank = u < initial_ranks.size() ? initial_ranks[u] : std::numeric_limits<int>::min();
+            for (auto v : g.in_neighbours(u)) {
+                rank = std::max(rank, h.ranking[v] + 1);
+            }
+            h.ranking[u] = rank == std::numeric_limits<int>::min() ? 0 : rank;
+
+            for (auto v : g.out_neighbours(u)) {
+                if (--in_degree[v] == 0) {
+                    to_rank.push_back(v);
+                }
+            }
+        }
+        return h;
+    }
+
     /**
      * Constructs a tree of all vertices
      * reachable from the root through tight edges. 
@@ -681,6 +855,10 @@ private:
         int iters = 0;
 
         while(true) {
+            if (cancellation) {
+                cancellation->throw_if_cancelled();
+            }
+
             auto leaving = find_leaving_edge(h);
             if (!leaving)
                 break;
@@ -696,9 +874,7 @@ private:
             iters++;
         }
 
-#ifdef REPORTING
-        report::simplex::iters = iters;
-#endif
+        iterations = iters;
     }
 
 };
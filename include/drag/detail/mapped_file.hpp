@@ -0,0 +1,82 @@
+#pragma once
+
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define DRAG_HAS_MMAP
+#endif
+
+namespace drag {
+
+namespace detail {
+
+/**
+ * Read-only contents of a file.
+ * The file is mapped into memory where mmap is available, otherwise it is read into a buffer.
+ */
+class mapped_file {
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+    std::string m_buffer;  // the contents if the file is not mapped
+
+public:
+    explicit mapped_file(const std::string& filename) {
+#ifdef DRAG_HAS_MMAP
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::invalid_argument("Cannot open the file '" + filename + "'");
+        }
+
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Cannot read the size of the file '" + filename + "'");
+        }
+        m_size = info.st_size;
+
+        if (m_size > 0) {
+            void* data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("Cannot map the file '" + filename + "'");
+            }
+            m_data = static_cast<const char*>(data);
+        }
+        ::close(fd);
+#else
+        std::ifstream in(filename, std::ios::binary);
+        if (!in) {
+            throw std::invalid_argument("Cannot open the file '" + filename + "'");
+        }
+        m_buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        m_data = m_buffer.data();
+        m_size = m_buffer.size();
+#endif
+    }
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    ~mapped_file() {
+#ifdef DRAG_HAS_MMAP
+        if (m_data) {
+            ::munmap(const_cast<char*>(m_data), m_size);
+        }
+#endif
+    }
+
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    std::string_view contents() const { return { m_data, m_size }; }
+};
+
+} // namespace detail
+
+} // namespace drag
@@ -0,0 +1,351 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <tuple>
+
+#include <drag/types.hpp>
+#include <drag/vec2.hpp>
+#include <drag/detail/utils.hpp>
+#include <drag/detail/spline.hpp>
+
+namespace drag {
+
+namespace detail {
+
+// the number of straight parts a cubic Bézier segment is approximated by
+const int curve_pieces = 8;
+
+/**
+ * The poly-line approximating the path <p>, which is either a path or a path_ref.
+ * Each curve segment of a curved path is split into curve_pieces parts.
+ */
+template<typename Path>
+std::vector<vec2> flatten(const Path& p) {
+    if (!p.curved) {
+        return { p.points.begin(), p.points.end() };
+    }
+
+    std::vector<vec2> points { p.points[0] };
+    for (size_t i = 0; i + 3 < p.points.size(); i += 3) {
+        bezier b = { p.points[i], p.points[i + 1], p.points[i + 2], p.points[i + 3] };
+        for (int k = 1; k <= curve_pieces; ++k) {
+            points.push_back( bezier_point(b, float(k)/curve_pieces) );
+        }
+    }
+    return points;
+}
+
+// are the vectors pointing in the same direction?
+inline bool same_direction(vec2 u, vec2 v) {
+    return std::abs(cross(u, v)) <= 1e-3f*magnitude(u)*magnitude(v) && dot(u, v) > 0;
+}
+
+/**
+ * Counts the points where the path <p> changes its direction.
+ * The joints of the curve segments of a curved path are bends only if the curve is not smooth there.
+ */
+template<typename Path>
+int count_bends(const Path& p) {
+    int count = 0;
+    if (p.curved) {
+        for (size_t i = 3; i + 1 < p.points.size(); i += 3) {
+            if (!same_direction(p.points[i] - p.points[i - 1], p.points[i + 1] - p.points[i]))
+                ++count;
+        }
+        return count;
+    }
+
+    std::optional<vec2> prev;
+    for (size_t i = 1; i < p.points.size(); ++i) {
+        vec2 dir = p.points[i] - p.points[i - 1];
+        if (dir == vec2{ 0, 0 })
+            continue;
+        if (prev && !same_direction(*prev, dir))
+            ++count;
+        prev = dir;
+    }
+    return count;
+}
+
+/**
+ * Straight part of an edge.
+ * The end <a> is above the end <b>, or to the left of it if the segment is horizontal.
+ */
+struct edge_segment {
+    double ax, ay, bx, by;
+    unsigned path;  // the index of the edge the segment belongs to
+};
+
+/**
+ * Collects the segments of the poly-lines approximating the paths, leaving out the ones of zero length.
+ */
+template<typename Paths>
+std::vector<edge_segment> make_segments(const Paths& paths) {
+    std::vector<edge_segment> segments;
+    for (unsigned i = 0; i < paths.size(); ++i) {
+        auto points = flatten(paths[i]);
+        for (size_t j = 1; j < points.size(); ++j) {
+            vec2 a = points[j - 1], b = points[j];
+            if (a == b)
+                continue;
+            if (b.y < a.y || (b.y == a.y && b.x < a.x)) {
+                std::swap(a, b);
+            }
+            segments.push_back({ a.x, a.y, b.x, b.y, i });
+        }
+    }
+    return segments;
+}
+
+/**
+ * Counts the pairs of crossing segments of different edges by sweeping them from top to bottom.
+ *
+ * The segments intersecting the sweep line are kept in buckets by their horizontal extent,
+ * and each new segment is tested only against the segments sharing a bucket with it.
+ * The edges of a layered layout span only a few layers, so this is close to linear
+ * in the number of segments and crossings.
+ * Segments which only share an endpoint and parallel segments do not cross.
+ */
+class segment_sweep {
+    const double eps = 1e-4;
+
+    const std::vector<edge_segment>& segs;
+
+    double left = 0;
+    double bucket_width = 1;
+    int bucket_count = 1;
+
+public:
+    segment_sweep(const std::vector<edge_segment>& segments) : segs(segments) {}
+
+    /**
+     * Returns the number of pairs of crossing segments.
+     */
+    int run() {
+        if (segs.empty())
+            return 0;
+
+        // the buckets are about as wide as an average segment, so each segment falls into a few of them
+        left = std::numeric_limits<double>::max();
+        double right = std::numeric_limits<double>::lowest();
+        double extent = 0;
+        for (const auto& s : segs) {
+            left = std::min({ left, s.ax, s.bx });
+            right = std::max({ right, s.ax, s.bx });
+            extent += std::abs(s.bx - s.ax);
+        }
+        bucket_width = std::max({ extent/segs.size(), (right - left)/segs.size(), 1.0 });
+        bucket_count = int((right - left)/bucket_width) + 1;
+
+        std::vector<unsigned> sorted(segs.size());
+        std::iota(sorted.begin(), sorted.end(), 0);
+        std::stable_sort(sorted.begin(), sorted.end(), [this] (unsigned i, unsigned j) {
+            return segs[i].ay < segs[j].ay;
+        });
+
+        int count = 0;
+        std::vector< std::vector<unsigned> > active(bucket_count);
+        for (auto i : sorted) {
+            auto [ first, last ] = buckets(i);
+            for (int b = first; b <= last; ++b) {
+                auto& bucket = active[b];
+                for (size_t k = 0; k < bucket.size(); ) {
+                    unsigned j = bucket[k];
+                    // the segments ending above the sweep line can't cross any of the remaining ones
+                    if (segs[j].by < segs[i].ay - eps) {
+                        bucket[k] = bucket.back();
+                        bucket.pop_back();
+                        continue;
+                    }
+                    // each pair is tested only in the leftmost bucket shared by both segments
+                    if (b == std::max(first, buckets(j).first) && crosses(i, j)) {
+                        ++count;
+                    }
+                    ++k;
+                }
+                bucket.push_back(i);
+            }
+        }
+        return count;
+    }
+
+private:
+    // the range of buckets covered by the segment <i>
+    std::pair<int, int> buckets(unsigned i) const {
+        const auto& s = segs[i];
+        auto bucket = [this] (double x) {
+            return std::clamp(int((x - left)/bucket_width), 0, bucket_count - 1);
+        };
+        return { bucket(std::min(s.ax, s.bx)), bucket(std::max(s.ax, s.bx)) };
+    }
+
+    bool crosses(unsigned i, unsigned j) const {
+        const auto& s = segs[i];
+        const auto& t = segs[j];
+        if (s.path == t.path)
+            return false;
+
+        double rx = s.bx - s.ax, ry = s.by - s.ay;
+        double qx = t.bx - t.ax, qy = t.by - t.ay;
+        double len_s = std::hypot(rx, ry), len_t = std::hypot(qx, qy);
+        double denom = rx*qy - ry*qx;
+        if (std::abs(denom) <= 1e-9*len_s*len_t)
+            return false;
+
+        double wx = t.ax - s.ax, wy = t.ay - s.ay;
+        double u = (wx*qy - wy*qx)/denom;  // the parameter on <s>
+        double v = (wx*ry - wy*rx)/denom;  // the parameter on <t>
+        if (u < -eps/len_s || u > 1 + eps/len_s || v < -eps/len_t || v > 1 + eps/len_t)
+            return false;
+
+        // touching at a common endpoint is not a crossing
+        double x = s.ax + u*rx, y = s.ay + u*ry;
+        auto is_end = [this, x, y] (const edge_segment& e) {
+            auto near = [this, x, y] (double px, double py) {
+                return std::abs(px - x) <= eps && std::abs(py - y) <= eps;
+            };
+            return near(e.ax, e.ay) || near(e.bx, e.by);
+        };
+        return !(is_end(s) && is_end(t));
+    }
+};
+
+/**
+ * Does the segment from <a> to <b> go through the inside of the node <n>?
+ * The node is shrunk by <tolerance>, so the segments touching its border don't count.
+ */
+inline bool segment_enters(const node& n, vec2 a, vec2 b, float tolerance) {
+    float hx = n.half_size.x - tolerance;
+    float hy = n.half_size.y - tolerance;
+    if (hx <= 0 || hy <= 0)
+        return false;
+
+    vec2 s = a - n.pos;
+    vec2 d = b - a;
+
+    if (n.shape == node_shape::rectangle) {
+        // clip the segment by the slabs of the rectangle
+        float t0 = 0, t1 = 1;
+        for (auto [ start, dir, h ] : { std::tuple{ s.x, d.x, hx }, std::tuple{ s.y, d.y, hy } }) {
+            if (dir == 0) {
+                if (std::abs(start) >= h)
+                    return false;
+                continue;
+            }
+            float ta = (-h - start)/dir;
+            float tb = (h - start)/dir;
+            t0 = std::max(t0, std::min(ta, tb));
+            t1 = std::min(t1, std::max(ta, tb));
+        }
+        return t0 < t1;
+    }
+
+    // the ellipse becomes a unit circle after scaling
+    s = { s.x/hx, s.y/hy };
+    d = { d.x/hx, d.y/hy };
+    float len = dot(d, d);
+    float t = len == 0 ? 0 : std::clamp(-dot(s, d)/len, 0.0f, 1.0f);
+    vec2 c = s + t*d;
+    return dot(c, c) < 1;
+}
+
+/**
+ * Counts the pairs of an edge and a node other than its endpoints, such that the edge goes through the node.
+ *
+ * The nodes are put into a uniform grid with cells about the size of the largest node
+ * and each segment is tested only against the nodes in the cells it passes through.
+ */
+template<typename Paths>
+int count_node_overlaps(const std::vector<node>& nodes, const Paths& paths, float tolerance) {
+    if (nodes.empty() || paths.empty())
+        return 0;
+
+    // the extent of the grid covers all the nodes and points
+    vec2 lo = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+    vec2 hi = { std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+    auto extend = [&lo, &hi] (vec2 a, vec2 b) {
+        lo = { std::min(lo.x, a.x), std::min(lo.y, a.y) };
+        hi = { std::max(hi.x, b.x), std::max(hi.y, b.y) };
+    };
+    float largest = 0;
+    for (const auto& n : nodes) {
+        extend(n.pos - n.half_size, n.pos + n.half_size);
+        largest = std::max(largest, 2*std::max(n.half_size.x, n.half_size.y));
+    }
+
+    std::vector< std::vector<vec2> > lines;
+    for (const auto& p : paths) {
+        lines.push_back(flatten(p));
+        for (auto q : lines.back()) {
+            extend(q, q);
+        }
+    }
+
+    // at most about as many cells as there are nodes
+    float cell = std::max({ largest, std::sqrt((hi.x - lo.x)*(hi.y - lo.y)/nodes.size()), 1.0f });
+    int cols = int((hi.x - lo.x)/cell) + 1;
+    int rows = int((hi.y - lo.y)/cell) + 1;
+    auto col = [&] (float x) { return std::clamp(int((x - lo.x)/cell), 0, cols - 1); };
+    auto row = [&] (float y) { return std::clamp(int((y - lo.y)/cell), 0, rows - 1); };
+
+    std::vector< std::vector<unsigned> > cells(cols*rows);
+    for (unsigned i = 0; i < nodes.size(); ++i) {
+        const auto& n = nodes[i];
+        for (int r = row(n.pos.y - n.half_size.y); r <= row(n.pos.y + n.half_size.y); ++r) {
+            for (int c = col(n.pos.x - n.half_size.x); c <= col(n.pos.x + n.half_size.x); ++c) {
+                cells[r*cols + c].push_back(i);
+            }
+        }
+    }
+
+    int count = 0;
+    std::vector<unsigned> found(nodes.size(), std::numeric_limits<unsigned>::max());  // the last path going through each node
+    for (unsigned k = 0; k < paths.size(); ++k) {
+        const auto& points = lines[k];
+        for (size_t j = 1; j < points.size(); ++j) {
+            vec2 a = points[j - 1], b = points[j];
+
+            // walk through the cells along the segment
+            int c = col(a.x), r = row(a.y);
+            int c_end = col(b.x), r_end = row(b.y);
+            vec2 d = b - a;
+            int step_c = sgn(d.x), step_r = sgn(d.y);
+            float inf = std::numeric_limits<float>::infinity();
+            float next_c = d.x == 0 ? inf : (lo.x + (c + (d.x > 0))*cell - a.x)/d.x;
+            float next_r = d.y == 0 ? inf : (lo.y + (r + (d.y > 0))*cell - a.y)/d.y;
+            float delta_c = d.x == 0 ? inf : cell/std::abs(d.x);
+            float delta_r = d.y == 0 ? inf : cell/std::abs(d.y);
+
+            for (int steps = std::abs(c_end - c) + std::abs(r_end - r); ; --steps) {
+                for (auto i : cells[r*cols + c]) {
+                    const auto& n = nodes[i];
+                    if (found[i] == k || n.u == paths[k].from || n.u == paths[k].to)
+                        continue;
+                    if (segment_enters(n, a, b, tolerance)) {
+                        found[i] = k;
+                        ++count;
+                    }
+                }
+                if (steps <= 0)
+                    break;
+                if (next_c < next_r) {
+                    c = std::clamp(c + step_c, 0, cols - 1);
+                    next_c += delta_c;
+                } else {
+                    r = std::clamp(r + step_r, 0, rows - 1);
+                    next_r += delta_r;
+                }
+            }
+        }
+    }
+    return count;
+}
+
+} // namespace detail
+
+} // namespace drag
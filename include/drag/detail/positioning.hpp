@@ -10,10 +10,6 @@
 #include <drag/vec2.hpp>
 #include <drag/detail/layering.hpp>
 
-#ifdef DEBUG_COORDINATE
-int produce_layout = 0;
-#endif
-
 namespace drag {
 
 namespace detail {
@@ -78,6 +74,55 @@ struct bounding_box {
 };
 
 
+/**
+ * Places the vertices of each layer next to each other in their order, with the layers centered.
+ * Much faster than fast_and_simple_positioning but the edges are not straightened, used for previews of a layout.
+ */
+class simple_positioning : public positioning {
+    std::vector<node>& nodes;
+    attributes attr;
+    const detail::vertex_map<bounding_box>& boxes;
+
+public:
+    simple_positioning(attributes attr, std::vector<node>& nodes, const detail::vertex_map<bounding_box>& boxes)
+        : nodes(nodes)
+        , attr(attr)
+        , boxes(boxes) {}
+
+    vec2 run(detail::hierarchy& h, vec2 origin) override {
+        std::vector<float> widths(h.size(), 0);
+        float width = 0;
+        for (int l = 0; l < h.size(); ++l) {
+            for (auto u : h.layers[l]) {
+                widths[l] += boxes[u].size.x + attr.node_dist;
+            }
+            widths[l] = std::max(0.0f, widths[l] - attr.node_dist);
+            width = std::max(width, widths[l]);
+        }
+
+        // the layers are as high as their highest node, as in fast_and_simple_positioning
+        float y = origin.y;
+        for (int l = 0; l < h.size(); ++l) {
+            float above = 0, below = 0;
+            for (auto u : h.layers[l]) {
+                above = std::max(above, boxes[u].center.y);
+                below = std::max(below, boxes[u].size.y - boxes[u].center.y);
+            }
+
+            y += above;
+            float x = origin.x + (width - widths[l])/2;
+            for (auto u : h.layers[l]) {
+                nodes[u].pos = { x + boxes[u].center.x, y };
+                x += boxes[u].size.x + attr.node_dist;
+            }
+            y += below + attr.layer_dist;
+        }
+
+        return { width, y - attr.layer_dist - origin.y };
+    }
+};
+
+
 class fast_and_simple_positioning : public positioning {
     std::vector<node>& nodes;
     attributes attr;
@@ -97,6 +142,8 @@ class fast_and_simple_positioning : public positioning {
 
     edge_set conflicting;
 
+    int alignment = -1;  // if 0 to 3, only this alignment is used, for debugging
+
 public:
     fast_and_simple_positioning(attributes attr, 
                                 std::vector<node>& nodes,
@@ -107,6 +154,12 @@ public:
         , boxes(boxes)
     { }
 
+    /**
+     * Uses only the alignment <a> (0 to 3) instead of the median of all four, -1 uses all of them.
+     * Used by the layout_debug of a layout.
+     */
+    void use_alignment(int a) { alignment = a; }
+
     void init(const detail::hierarchy& h) {
         for (int i = 0; i < 4; ++i) {
             medians[i].resize(h.g);
@@ -114,7 +167,8 @@ public:
             align[i].resize(h.g);
             sink[i].resize(h.g);
             shift[i].resize(h.g);
-            x[i].resize(h.g);
+            // the positions may be left from a previous graph if the module is reused
+            x[i].init(h.g, std::nullopt);
 
             min[i] = std::numeric_limits<float>::max();
             max[i] = std::numeric_limits<float>::lowest();
@@ -128,6 +182,8 @@ public:
                 shift[j][u] = 0;
             }
         }
+
+        conflicting.data.clear();
     }
 
     vec2 run(detail::hierarchy& h, vec2 origin) override {
@@ -149,25 +205,6 @@ public:
             horizontal_compaction(h, static_cast<orient>(i));
         }
 
-#ifdef DEBUG_COORDINATE
-        if(produce_layout < 4) {
-            std::cout << "TYPE: " << produce_layout << "\n";
-            for (auto u : h.g.vertices()) {
-                if (root[produce_layout][u] == u) {
-                    vertex_t v = u;
-                    const char* sep = "";
-                    do {
-                        std::cout << sep << v;
-                        sep = " -> ";
-                        v = align[produce_layout][v];
-                    } while (v != u);
-                    std::cout << "\n";
-                }
-            }
-            std::cout << "\n";
-        }
-#endif
-
         // find the layout with smallest width
         orient min_width_layout = static_cast<orient>(0);
         for (int i = 1; i < 4; ++i) {
@@ -176,11 +213,6 @@ public:
             }
         }
 
-#ifdef DEBUG_COORDINATE
-        if (produce_layout < 4)
-            normalize(h, x[min_width_layout], 0);
-#endif
-
         // calculate how much other layouts need to be shifted to align them to the smallest width one
         float shift[4];
         for (int i = 0; i < 4; ++i) {
@@ -199,24 +231,27 @@ public:
         float y = origin.y;
         std::vector<float> vals;
         for (int l = 0; l < h.size(); ++l) {
-            y += attr.node_size;
+            // each layer is as high as its highest node, so the layers of dummy vertices take no space
+            float above = 0, below = 0;
             for (auto u : h.layers[l]) {
-#ifdef DEBUG_COORDINATE
-                if(produce_layout < 4) {
-                    nodes[u].pos = vec2{ *x[produce_layout][u] + shift[produce_layout], y };
-                } else {
-#endif
+                above = std::max(above, boxes[u].center.y);
+                below = std::max(below, boxes[u].size.y - boxes[u].center.y);
+            }
+
+            y += above;
+            for (auto u : h.layers[l]) {
+                if (alignment >= 0 && alignment < 4) {
+                    nodes[u].pos = vec2{ *x[alignment][u] + shift[alignment], y };
+                    continue;
+                }
                 vals = { *x[0][u] + shift[0],
                          *x[1][u] + shift[1],
                          *x[2][u] + shift[2],
                          *x[3][u] + shift[3] };
                 std::sort(vals.begin(), vals.end());
                 nodes[u].pos = { (vals[1] + vals[2])/2, y };
-#ifdef DEBUG_COORDINATE
-                }
-#endif
             }
-            y += attr.node_size + attr.layer_dist;
+            y += below + attr.layer_dist;
         }
         float height = y - attr.layer_dist;
 
@@ -2,11 +2,16 @@
 
 #include <drag/types.hpp>
 #include <drag/detail/subgraph.hpp>
+#include <drag/detail/spline.hpp>
+#include <drag/detail/shape.hpp>
 
 #include <vector>
 #include <cmath>
 #include <optional>
 #include <algorithm>
+#include <array>
+#include <queue>
+#include <limits>
 
 namespace drag {
 
@@ -17,6 +22,117 @@ struct edge_router {
     virtual ~edge_router() = default;
 };
 
+/**
+ * Creates a loop leaving the right side of the node <n> above its center and returning below it.
+ */
+inline path loop_path(const attributes& attr, const node& n) {
+    path l{ n.u, n.u, {} };
+    l.points.resize(4);
+
+    float sin_a = std::sin(to_radians(attr.loop_angle));
+    float cos_a = std::cos(to_radians(attr.loop_angle));
+    if (is_circle(n)) {
+        l.points[0] = n.pos + vec2{ n.size * sin_a, -n.size * cos_a };
+        l.points[3] = n.pos + vec2{ n.size * sin_a, n.size * cos_a };
+    } else {
+        l.points[0] = border_point(n, { sin_a, -cos_a });
+        l.points[3] = border_point(n, { sin_a, cos_a });
+    }
+
+    l.points[1] = vec2{ n.pos.x + n.half_size.x + attr.loop_size/2, l.points[0].y };
+    l.points[2] = vec2{ n.pos.x + n.half_size.x + attr.loop_size/2, l.points[3].y };
+
+    return l;
+}
+
+/**
+ * Resets <l> to an empty path from <u> to <v>, keeping the memory allocated for its points.
+ */
+inline void start_path(path& l, vertex_t u, vertex_t v) {
+    l.from = u;
+    l.to = v;
+    l.points.clear();
+    l.bidirectional = false;
+    l.curved = false;
+}
+
+/**
+ * Reverses the direction of the path.
+ */
+inline void reverse(path& l) {
+    std::swap(l.from, l.to);
+    std::reverse(l.points.begin(), l.points.end());
+}
+
+/**
+ * Finds the smallest shift <s> >= <start> of the end of an edge at <p>, such that the line
+ * from p + (0, <dir_y>*s) to <other> is further than <r> from the point <c>.
+ * The shift is clipped to <max_shift>.
+ * 
+ * The distance is at most <r> when (k + m*y)^2 <= r^2 * ((bx - ax)^2 + (by - y)^2)
+ * where y is the shifted coordinate, so the shift is found as a root of a quadratic equation.
+ */
+inline float min_clearing_shift(vec2 p, float dir_y, float start, vec2 other, vec2 c, float r, float max_shift) {
+    // computed relative to <p> and in double precision, the coefficients get large
+    double u = other.x - p.x;
+    double w = c.x - p.x;
+    double by = other.y - p.y;
+    double cy = c.y - p.y;
+    double k = u*cy - w*by;
+    double m = w - u;
+    double rr = double(r)*r;
+
+    // coefficients of the quadratic in y
+    double a2 = m*m - rr;
+    double a1 = 2*(k*m + rr*by);
+    double a0 = k*k - rr*u*u - rr*by*by;
+
+    auto clears = [&] (float s) {
+        double y = dir_y*s;
+        return (a2*y + a1)*y + a0 > 0;
+    };
+
+    if (start >= max_shift || clears(start)) {
+        return std::min(start, max_shift);
+    }
+
+    std::array<double, 2> roots;
+    int count = 0;
+    if (a2 == 0) {
+        if (a1 != 0) {
+            roots[count++] = -a0/a1;
+        }
+    } else {
+        double discriminant = a1*a1 - 4*a2*a0;
+        if (discriminant >= 0) {
+            discriminant = std::sqrt(discriminant);
+            roots[count++] = (-a1 - discriminant)/(2*a2);
+            roots[count++] = (-a1 + discriminant)/(2*a2);
+        }
+    }
+
+    // convert the roots to shifts and take the first one after which the line clears the point
+    std::array<float, 2> candidates;
+    int found = 0;
+    for (int i = 0; i < count; ++i) {
+        float shift = roots[i]*dir_y;
+        if (shift > start) {
+            candidates[found++] = shift;
+        }
+    }
+    if (found == 2 && candidates[1] < candidates[0]) {
+        std::swap(candidates[0], candidates[1]);
+    }
+
+    for (int i = 0; i < found && candidates[i] < max_shift; ++i) {
+        float s = std::nextafter(candidates[i], max_shift);
+        if (clears(s)) {
+            return s;
+        }
+    }
+    return max_shift;
+}
+
 class router : public edge_router {
     const float min_sep = 5;
     const float loop_angle_sep = 5;
@@ -25,17 +141,20 @@ class router : public edge_router {
     
     const attributes& attr;
     std::vector<node>& nodes;
-    std::vector<path>& links;
+    path_list& links;
 
     vertex_map< std::array< float, 4 > > angles;
     vertex_map< std::array< float, 4 > > bound;
 
     vertex_map< std::array< float, 4> > shifts;
+    vertex_map< float > shift_limit;
 
     vertex_map< bool > loop;
 
+    path current;  // the path being routed, reused to avoid allocating the points of every edge
+
 public:
-    router(std::vector<node>& nodes, std::vector<path>& paths, const attributes& attr) 
+    router(std::vector<node>& nodes, path_list& paths, const attributes& attr) 
         : attr(attr)
         , nodes(nodes)
         , links(paths) {}
@@ -44,6 +163,7 @@ public:
         angles.init( h.g, { 90, 90, 90, 90 } );
         bound.init( h.g, { 0 } );
         shifts.init( h.g, { 0 } );
+        init_shift_limits(h);
         min_shift = attr.node_size/2;
         loop_height = attr.node_size/2;
         loop.init(h.g, false);
@@ -55,12 +175,10 @@ public:
 
         //set_dummy_shifts(h);
 
-        for (const auto l : h.layers) {
-            for (int d : { 1, -1 }) {
-                for (auto u : l) {
-                    for (auto v : h.g.out_neighbours(u)) {
-                        if (!h.g.is_dummy(u) || !h.g.is_dummy(v)) set_regular_shifts2(h, {u, v});
-                    }
+        for (const auto& l : h.layers) {
+            for (auto u : l) {
+                for (auto v : h.g.out_neighbours(u)) {
+                    if (!h.g.is_dummy(u) || !h.g.is_dummy(v)) set_regular_shifts2(h, {u, v});
                 }
             }
         }
@@ -82,6 +200,24 @@ public:
 
 private:
 
+    /**
+     * The ends of the edges at a vertex can be shifted up to the half height of the highest node in its layer.
+     * If that is more than the height of the node itself, the edge continues vertically to the shifted point,
+     * so it can avoid the higher nodes next to it. The dummy vertices have no height of their own.
+     */
+    void init_shift_limits(const hierarchy& h) {
+        shift_limit.init( h.g, attr.node_size );
+        for (const auto& l : h.layers) {
+            float limit = 0;
+            for (auto u : l) {
+                limit = std::max(limit, nodes[u].half_size.y);
+            }
+            for (auto u : l) {
+                if (!h.g.is_dummy(u)) shift_limit[u] = limit;
+            }
+        }
+    }
+
     void set_regular_shifts2(const hierarchy& h, edge e) {
         auto dirs = get_dirs(e);
         if (dirs.x == 0)
@@ -113,52 +249,38 @@ private:
         float r_up = 0;
         if (up) {
             c_up = pos(*up);
-            r_up = h.g.is_dummy(*up) ? shifts[*up][angle_idx(dirs)] : attr.node_size;
+            r_up = h.g.is_dummy(*up) ? shifts[*up][angle_idx(dirs)] : nodes[*up].size;
         }
 
         vec2 c_down = pos(e.from) - dirs.x*10;
         float r_down = 0;
         if (down) {
             c_down = pos(*down);
-            r_down = h.g.is_dummy(*down) ? shifts[*down][angle_idx(-dirs)] : attr.node_size;
+            r_down = h.g.is_dummy(*down) ? shifts[*down][angle_idx(-dirs)] : nodes[*down].size;
         }
 
         bool can_inter_up = sgn(c_up.x - from.x) != sgn(c_up.x - to.x);
         bool can_inter_down = sgn(c_down.x - from.x) != sgn(c_down.x - to.x);
 
-        float node_size = attr.node_size;
-
         // if it is possible for the edge to intersect the vertex
         if ( can_inter_up || can_inter_down ) {
             float s = get_shift(e.from, dirs);
             float t = get_shift(e.to, -dirs);
 
-            bool up_done = true, down_done = true;
-            while (true) {
-                if (can_inter_up && s <= node_size && line_point_dist(from, to, c_up) <= r_up + min_sep) {
-                    s += 5;
-                    from = pos(e.from) + vec2{ 0, dirs.y*s };
-                    up_done = false;
-                } else {
-                    up_done = true;
-                }
+            // moving one end of the edge moves the line, so the other end might have to move again
+            for (int i = 0; i < 4; ++i) {
+                float new_s = can_inter_up ? min_clearing_shift(pos(e.from), dirs.y, s, to, c_up, r_up + min_sep, shift_limit[e.from]) : s;
+                from = pos(e.from) + vec2{ 0, dirs.y*new_s };
 
-                if (can_inter_down && t <= node_size && line_point_dist(to, from, c_down) <= r_down + min_sep) {
-                    t += 5;
-                    to = pos(e.to) + vec2{ 0, -dirs.y*t };
-                    down_done = false;
-                } else {
-                    down_done = true;
-                }
+                float new_t = can_inter_down ? min_clearing_shift(pos(e.to), -dirs.y, t, from, c_down, r_down + min_sep, shift_limit[e.to]) : t;
+                to = pos(e.to) + vec2{ 0, -dirs.y*new_t };
 
-                if (up_done && down_done)
+                if (new_s == s && new_t == t)
                     break;
+                s = new_s;
+                t = new_t;
             }
 
-            // clip it
-            if (s > node_size) s = node_size;
-            if (t > node_size) t = node_size;
-
             shifts[e.from][angle_idx(dirs)] = std::max(shifts[e.from][angle_idx(dirs)], s);
             shifts[e.to][angle_idx(-dirs)] = std::max(shifts[e.to][angle_idx(-dirs)], t);
         }
@@ -239,7 +361,7 @@ private:
         float s = get_shift(e.from, dirs);
         auto from = get_center(e.from, dirs);
         auto to = get_center(e.to, -dirs);
-        auto intersection = *edge_intersects(from, to, nodes[e.from].pos, nodes[e.from].size);
+        auto intersection = exit_point(e.from, from, to);
         float a = angle(pos(e.from), intersection);
 
         if (a > attr.loop_angle - loop_angle_sep) {
@@ -249,7 +371,7 @@ private:
             float t = (pos(e.from).x - p.x)/(p.x - to.x);
             s = fabs( pos(e.from).y - (p.y + t*(p.y - to.y)) );
 
-            assert(s >= 0 && s <= nodes[e.from].size);
+            assert(s >= 0 && s <= nodes[e.from].half_size.y);
 
             shifts[e.from][angle_idx(dirs)] = s;
         }
@@ -319,11 +441,17 @@ private:
 
 
     void make_path(hierarchy& h, const rev_edges& rev, vertex_t u, vertex_t v) {
-        auto& g = h.g;
-        path l{ u, v, {} };
-        auto orig = edge{ u, v };
+        start_path(current, u, v);
+        add_port(current, u, nodes[v].pos - nodes[u].pos, false);
+        follow_path(h, rev, edge{ u, v }, current, u, v);
+    }
 
-        l.points.push_back( calculate_port_shifted(u, nodes[v].pos - nodes[u].pos) );
+    /**
+     * Continues the path <l> along the edge (<u>, <v>) until it reaches a non-dummy vertex.
+     * If the edges were concentrated, the path splits at the dummy vertices with several out neighbours.
+     */
+    void follow_path(hierarchy& h, const rev_edges& rev, edge orig, path& l, vertex_t u, vertex_t v) {
+        auto& g = h.g;
 
         while (g.is_dummy(v)) {
             auto s = shifts[v][angle_idx(get_dirs(edge{v, u}))];
@@ -332,16 +460,19 @@ private:
             
             l.points.push_back( nodes[v].pos );
 
-            auto n = next(g, v);
-            s = shifts[v][angle_idx(get_dirs(edge{v, n}))];
-            if (s > 0)
-                l.points.push_back( nodes[v].pos + vec2{ 0, s } );
+            const auto& out = g.out_neighbours(v);
+            for (size_t i = 1; i < out.size(); ++i) {
+                path branch = l;
+                leave_dummy(branch, v, out[i]);
+                follow_path(h, rev, orig, branch, v, out[i]);
+            }
+            leave_dummy(l, v, out[0]);
 
             u = v;
-            v = n;
+            v = out[0];
         }
 
-        l.points.push_back( calculate_port_shifted(v, nodes[u].pos - nodes[v].pos) );
+        add_port(l, v, nodes[u].pos - nodes[v].pos, true);
         l.to = v;
 
         if (rev.reversed.contains(orig)) {
@@ -350,14 +481,13 @@ private:
             l.bidirectional = true;
         }
 
-        links.push_back(std::move(l));
+        links.push_back(l);
     }
 
-    void reverse(path& l) {
-        std::swap(l.from, l.to);
-        for (int i = 0; i < l.points.size()/2; ++i) {
-            std::swap(l.points[i], l.points[l.points.size() - i - 1]);
-        }
+    void leave_dummy(path& l, vertex_t v, vertex_t n) {
+        auto s = shifts[v][angle_idx(get_dirs(edge{v, n}))];
+        if (s > 0)
+            l.points.push_back( nodes[v].pos + vec2{ 0, s } );
     }
 
     // https://stackoverflow.com/questions/1073336/circle-line-segment-collision-detection-algorithm
@@ -404,34 +534,57 @@ private:
     }
 
     void make_loop_square(subgraph& g, vertex_t u) {
-        path l{ u, u, {} };
-        l.points.resize(4);
-
-        l.points[0] = angle_point(attr.loop_angle, u, { 1, -1 });
-        l.points[3] = angle_point(attr.loop_angle, u, { 1, 1 });
-
-        l.points[1] = vec2{ pos(u).x + attr.node_size + attr.loop_size/2, l.points[0].y };
-        l.points[2] = vec2{ pos(u).x + attr.node_size + attr.loop_size/2, l.points[3].y };
-
-        links.push_back(std::move(l));
+        links.push_back(loop_path(attr, nodes[u]));
     }
 
     vec2 angle_point(float angle, vertex_t u, vec2 dirs) {
-        return pos(u) + vec2{ dirs.x * attr.node_size * std::sin(to_radians(angle)),
-                              dirs.y * attr.node_size * std::cos(to_radians(angle)) };
+        vec2 dir = { dirs.x * std::sin(to_radians(angle)), dirs.y * std::cos(to_radians(angle)) };
+        if (!is_circle(nodes[u])) {
+            return border_point(nodes[u], dir);
+        }
+        return pos(u) + vec2{ dirs.x * nodes[u].size * std::sin(to_radians(angle)),
+                              dirs.y * nodes[u].size * std::cos(to_radians(angle)) };
     }
 
     vertex_t next(const subgraph& g, vertex_t u) { return *g.out_neighbours(u).begin(); }
     vertex_t prev(const subgraph& g, vertex_t u) { return *g.in_neighbours(u).begin(); }
 
+    /**
+     * Adds the port of the edge leaving the vertex <u> in the direction <dir> to the path <l>.
+     * If the end of the edge is shifted below or above the node, the vertical part is added as well.
+     */
+    void add_port(path& l, vertex_t u, vec2 dir, bool last) {
+        vec2 dirs { sgn(dir.x), sgn(dir.y) };
+        if (get_shift(u, dirs) <= nodes[u].half_size.y) {
+            l.points.push_back( calculate_port_shifted(u, dir) );
+            return;
+        }
+
+        vec2 border = pos(u) + vec2{ 0, dirs.y*nodes[u].half_size.y };
+        vec2 center = get_center(u, dirs);
+        if (last) {
+            std::swap(border, center);
+        }
+        l.points.push_back(border);
+        l.points.push_back(center);
+    }
+
     vec2 calculate_port_shifted(vertex_t u, vec2 dir) {
         vec2 dirs { sgn(dir.x), sgn(dir.y) };
         auto s = get_shift(u, dirs);
-        if (s == attr.node_size) {
-            return get_center(u, dirs);
+        if (s >= nodes[u].half_size.y) {
+            return pos(u) + vec2{ 0, dirs.y*nodes[u].half_size.y };
         }
         auto center = get_center(u, dirs);
-        return *edge_intersects(center, center + dir, pos(u), nodes[u].size);
+        return exit_point(u, center, center + dir);
+    }
+
+    // the point where the line from <from> inside of the vertex <u> towards <to> leaves it
+    vec2 exit_point(vertex_t u, vec2 from, vec2 to) {
+        if (is_circle(nodes[u])) {
+            return *edge_intersects(from, to, pos(u), nodes[u].size);
+        }
+        return detail::exit_point(nodes[u], from, to - from);
     }
 
     vec2 calculate_port_centered(vertex_t u, vec2 dir) {
@@ -453,6 +606,452 @@ private:
 
 };
 
+/**
+ * Router producing orthogonal edges, which consist only of horizontal and vertical segments.
+ *
+ * Each edge leaves the bottom of a vertex, runs horizontally on a track in the gap below
+ * its layer and enters the top of the next vertex on the path. Edges sharing an endpoint
+ * get separate ports spread over the border of the node. The tracks are assigned in each
+ * gap separately by sweeping the horizontal segments from left to right, so that no two
+ * overlapping segments share a track. This takes O(E log E) time for a gap with E edges.
+ */
+class orthogonal_router : public edge_router {
+    const float min_sep = 5;
+    const float port_eps = 2;
+
+    const attributes& attr;
+    std::vector<node>& nodes;
+    path_list& links;
+
+    // for each out edge of a vertex, in the order of the out neighbours:
+    vertex_map< std::vector<float> > from_x;  // x coordinate of the port on the vertex
+    vertex_map< std::vector<float> > to_x;    // x coordinate of the port on the neighbour
+    vertex_map< std::vector<float> > track_y; // y coordinate of the horizontal segment
+
+    path current;  // the path being routed, reused to avoid allocating the points of every edge
+
+    // horizontal segment of the edge from <u> to its <i>-th out neighbour
+    struct segment {
+        float left, right;
+        vertex_t u;
+        unsigned i;
+    };
+
+public:
+    orthogonal_router(std::vector<node>& nodes, path_list& paths, const attributes& attr) 
+        : attr(attr)
+        , nodes(nodes)
+        , links(paths) {}
+
+    void run(hierarchy& h, const rev_edges& rev) override {
+        from_x.init(h.g, {});
+        to_x.init(h.g, {});
+        track_y.init(h.g, {});
+
+        for (auto u : rev.loops) {
+            links.push_back(loop_path(attr, nodes[u]));
+        }
+
+        place_ports(h.g);
+        for (int i = 0; i + 1 < h.size(); ++i) {
+            assign_tracks(h, i);
+        }
+
+        for (auto u : h.g.vertices()) {
+            for (unsigned i = 0; i < h.g.out_degree(u); ++i) {
+                if (!h.g.is_dummy(u)) make_path(h.g, rev, u, i);
+            }
+        }
+    }
+
+private:
+    void place_ports(const subgraph& g) {
+        std::vector< std::pair<vertex_t, unsigned> > out, in;
+        vertex_map< std::vector< std::pair<vertex_t, unsigned> > > in_edges(g);
+
+        for (auto u : g.vertices()) {
+            out.clear();
+            for (unsigned i = 0; i < g.out_degree(u); ++i) {
+                out.emplace_back(g.out_neighbour(u, i), i);
+                in_edges[ g.out_neighbour(u, i) ].emplace_back(u, i);
+            }
+            from_x[u].resize(out.size());
+            to_x[u].resize(out.size());
+            track_y[u].resize(out.size());
+
+            spread(u, out, [this, u] (auto e, float x) { from_x[u][e.second] = x; });
+        }
+
+        for (auto v : g.vertices()) {
+            spread(v, in_edges[v], [this] (auto e, float x) { to_x[e.first][e.second] = x; });
+        }
+    }
+
+    /**
+     * Spreads the ports of the edges to the vertices <ends> over the middle of the node <u>,
+     * ordered by the x coordinates of the other endpoints so the edges don't cross needlessly.
+     */
+    template<typename Store>
+    void spread(vertex_t u, std::vector< std::pair<vertex_t, unsigned> >& ends, Store store) {
+        std::stable_sort(ends.begin(), ends.end(), [this] (const auto& a, const auto& b) {
+            return nodes[a.first].pos.x < nodes[b.first].pos.x;
+        });
+
+        float n = ends.size();
+        for (unsigned j = 0; j < ends.size(); ++j) {
+            store(ends[j], nodes[u].pos.x + nodes[u].half_size.x * ((j + 1)/(n + 1) - 0.5f));
+        }
+    }
+
+    // y coordinate of the point on the border of <u> at <x>, on the bottom if <dir_y> is positive
+    float port_y(vertex_t u, float x, float dir_y) const {
+        return nodes[u].pos.y + dir_y * border_height(nodes[u], x - nodes[u].pos.x);
+    }
+
+    /**
+     * Assigns the tracks for the edges between the layers <layer> and <layer> + 1.
+     */
+    void assign_tracks(const hierarchy& h, int layer) {
+        float top = -std::numeric_limits<float>::infinity();
+        float bottom = std::numeric_limits<float>::infinity();
+        for (auto u : h.layers[layer]) {
+            top = std::max(top, nodes[u].pos.y + nodes[u].half_size.y);
+        }
+        for (auto v : h.layers[layer + 1]) {
+            bottom = std::min(bottom, nodes[v].pos.y - nodes[v].half_size.y);
+        }
+
+        separate_ports(h, layer);
+
+        std::vector<segment> segments;
+        for (auto u : h.layers[layer]) {
+            for (unsigned i = 0; i < from_x[u].size(); ++i) {
+                float a = from_x[u][i];
+                float b = to_x[u][i];
+                if (a != b) {
+                    segments.push_back({ std::min(a, b), std::max(a, b), u, i });
+                }
+            }
+        }
+        std::sort(segments.begin(), segments.end(), [] (const segment& a, const segment& b) {
+            return a.left < b.left || (a.left == b.left && a.right < b.right);
+        });
+
+        // greedy colouring of the intervals uses the smallest possible number of tracks
+        using active_track = std::pair<float, unsigned>;  // right end of the segment and its track
+        std::priority_queue< active_track, std::vector<active_track>, std::greater<active_track> > active;
+        std::priority_queue< unsigned, std::vector<unsigned>, std::greater<unsigned> > free;
+        std::vector<unsigned> track(segments.size());
+        unsigned count = 0;
+
+        for (unsigned j = 0; j < segments.size(); ++j) {
+            while (!active.empty() && active.top().first + min_sep < segments[j].left) {
+                free.push(active.top().second);
+                active.pop();
+            }
+            if (free.empty()) {
+                track[j] = count++;
+            } else {
+                track[j] = free.top();
+                free.pop();
+            }
+            active.push({ segments[j].right, track[j] });
+        }
+
+        auto order = order_tracks(segments, track, count);
+        float step = (bottom - top)/(count + 1);
+        for (unsigned j = 0; j < segments.size(); ++j) {
+            const auto& s = segments[j];
+            track_y[s.u][s.i] = top + (order[ track[j] ] + 1)*step;
+        }
+    }
+
+    /**
+     * Moves the ports on the nodes of the lower layer which lie right below a port on the upper layer
+     * towards the other end of the edge, otherwise the vertical segments of the two edges could overlap.
+     */
+    void separate_ports(const hierarchy& h, int layer) {
+        std::vector<float> upper;
+        for (auto u : h.layers[layer]) {
+            upper.insert(upper.end(), from_x[u].begin(), from_x[u].end());
+        }
+        std::sort(upper.begin(), upper.end());
+
+        for (auto u : h.layers[layer]) {
+            for (unsigned i = 0; i < to_x[u].size(); ++i) {
+                vertex_t v = h.g.out_neighbour(u, i);
+                float from = from_x[u][i];
+                float& to = to_x[u][i];
+                if (h.g.is_dummy(v) || from == to)
+                    continue;
+
+                auto it = std::lower_bound(upper.begin(), upper.end(), to - port_eps);
+                if (it != upper.end() && *it < to + port_eps) {
+                    // away from the other port, but only by a third of the distance to the next port on the node,
+                    // so the ports stay apart even if the next one moves as well
+                    float dir = to == *it ? sgn(from - to) : sgn(to - *it);
+                    float shift = std::min(min_sep, nodes[v].half_size.x / (h.g.in_neighbours(v).size() + 1) / 3);
+                    if (dir == sgn(from - to)) {
+                        shift = std::min(shift, std::abs(from - to)/2);
+                    }
+                    to += dir * shift;
+                }
+            }
+        }
+    }
+
+    /**
+     * Orders the tracks from top to bottom.
+     * If an edge leaves the upper layer where another edge enters the lower one, the track
+     * of the first edge has to be above the other, otherwise their vertical segments overlap.
+     * The constraints are satisfied unless they are cyclic.
+     */
+    std::vector<unsigned> order_tracks(const std::vector<segment>& segments, const std::vector<unsigned>& track, unsigned count) {
+        std::vector< std::pair<float, unsigned> > ends;  // x coordinate of the lower port and the segment
+        for (unsigned j = 0; j < segments.size(); ++j) {
+            ends.emplace_back(to_x[segments[j].u][segments[j].i], j);
+        }
+        std::sort(ends.begin(), ends.end());
+
+        std::vector< std::vector<unsigned> > below(count);
+        std::vector<unsigned> in_degree(count, 0);
+        for (unsigned j = 0; j < segments.size(); ++j) {
+            float x = from_x[segments[j].u][segments[j].i];
+            auto it = std::lower_bound(ends.begin(), ends.end(), std::make_pair(x, 0u));
+
+            // the vertical segments overlap only if they are at the same position
+            for (auto k : { it, it == ends.begin() ? ends.end() : std::prev(it) }) {
+                if (k == ends.end() || std::abs(k->first - x) >= port_eps)
+                    continue;
+                unsigned a = track[j], b = track[k->second];
+                if (a != b) {
+                    below[a].push_back(b);
+                    ++in_degree[b];
+                }
+            }
+        }
+
+        std::vector<unsigned> order(count);
+        std::vector<bool> done(count, false);
+        std::priority_queue< unsigned, std::vector<unsigned>, std::greater<unsigned> > ready;
+        for (unsigned t = 0; t < count; ++t) {
+            if (in_degree[t] == 0) ready.push(t);
+        }
+
+        unsigned next = 0;
+        unsigned t = 0;
+        while (next < count) {
+            if (ready.empty()) {
+                // the constraints are cyclic, break the cycle at the first remaining track
+                while (done[t]) ++t;
+                ready.push(t);
+            }
+            auto a = ready.top();
+            ready.pop();
+            if (done[a])
+                continue;
+            done[a] = true;
+            order[a] = next++;
+            for (auto b : below[a]) {
+                if (!done[b] && --in_degree[b] == 0) ready.push(b);
+            }
+        }
+        return order;
+    }
+
+    void make_path(const subgraph& g, const rev_edges& rev, vertex_t u, unsigned i) {
+        start_path(current, u, g.out_neighbour(u, i));
+        float x = from_x[u][i];
+        current.points.push_back({ x, port_y(u, x, 1) });
+        follow_path(g, rev, edge{ u, current.to }, current, u, i);
+    }
+
+    /**
+     * Continues the path <l> along the <i>-th out edge of <u> until it reaches a non-dummy vertex.
+     * If the edges were concentrated, the path splits at the dummy vertices with several out neighbours.
+     */
+    void follow_path(const subgraph& g, const rev_edges& rev, edge orig, path& l, vertex_t u, unsigned i) {
+        vertex_t v = g.out_neighbour(u, i);
+        float x = l.points.back().x;
+
+        while (true) {
+            if (to_x[u][i] != x) {
+                l.points.push_back({ x, track_y[u][i] });
+                x = to_x[u][i];
+                l.points.push_back({ x, track_y[u][i] });
+            }
+            if (!g.is_dummy(v))
+                break;
+
+            for (unsigned j = 1; j < g.out_degree(v); ++j) {
+                path branch = l;
+                follow_path(g, rev, orig, branch, v, j);
+            }
+            u = v;
+            i = 0;
+            v = g.out_neighbour(u, 0);
+        }
+
+        l.points.push_back({ x, port_y(v, x, -1) });
+        l.to = v;
+
+        if (rev.reversed.contains(orig)) {
+            reverse(l);
+        } else if (rev.collapsed.contains(orig)) {
+            l.bidirectional = true;
+        }
+
+        links.push_back(l);
+    }
+};
+
+/**
+ * Router producing smooth edges.
+ * The edges are routed as poly-lines by the regular router first. Then the points on straight
+ * parts of the lines are dropped and the remaining bends are rounded by Bézier curves, as long
+ * as the curves don't intersect any node. So a long edge is described by a few curve segments
+ * instead of several points for each dummy vertex.
+ */
+class spline_router : public edge_router {
+    // the distance of the points of a curve which are checked for intersections with nodes
+    const float check_step = 2;
+
+    path_list lines;  // the poly-lines of the edges of the current component
+    router polyline;
+    const attributes& attr;
+    std::vector<node>& nodes;
+    path_list& links;
+
+    const hierarchy* h = nullptr;
+    std::vector<float> layer_y;
+    std::vector<vec2> bends;
+    path curve;
+    vec2 reach;  // the largest half size of a node
+
+public:
+    spline_router(std::vector<node>& nodes, path_list& paths, const attributes& attr)
+        : polyline(nodes, lines, attr)
+        , attr(attr)
+        , nodes(nodes)
+        , links(paths) {}
+
+    void run(hierarchy& h, const rev_edges& rev) override {
+        lines.clear();
+        polyline.run(h, rev);
+
+        this->h = &h;
+        layer_y.clear();
+        for (const auto& l : h.layers) {
+            layer_y.push_back(nodes[l[0]].pos.y);
+        }
+        reach = { 0, 0 };
+        for (auto u : h.g.vertices()) {
+            reach.x = std::max(reach.x, nodes[u].half_size.x);
+            reach.y = std::max(reach.y, nodes[u].half_size.y);
+        }
+
+        for (auto l : lines) {
+            make_curve(l);
+            links.push_back(curve);
+        }
+    }
+
+private:
+    // turns the poly-line <l> into the curve
+    void make_curve(path_ref l) {
+        start_path(curve, l.from, l.to);
+        curve.bidirectional = l.bidirectional;
+
+        // the loops are used as a single curve segment
+        if (l.from == l.to) {
+            curve.points.assign(l.points.begin(), l.points.end());
+            curve.curved = true;
+            return;
+        }
+
+        bends.assign(l.points.begin(), l.points.end());
+        remove_collinear(bends);
+        // straight lines are left as they are
+        if (bends.size() <= 2) {
+            curve.points.assign(l.points.begin(), l.points.end());
+            return;
+        }
+
+        auto& p = curve;
+        p.points.push_back(bends[0]);
+        vec2 current = bends[0];
+
+        for (size_t i = 1; i + 1 < bends.size(); ++i) {
+            vec2 prev = bends[i - 1];
+            vec2 corner = bends[i];
+            vec2 next = bends[i + 1];
+
+            // the curve around a bend can take up the whole segment at the ends of the path
+            // and a half of the segment between two bends
+            vec2 in = (i == 1 ? 1 : 0.5f)*(prev - corner);
+            vec2 out = (i + 2 == bends.size() ? 1 : 0.5f)*(next - corner);
+
+            // make the curve tighter until it avoids all the nodes
+            bool rounded = false;
+            for (float f = 1; f > 0.1f; f /= 2) {
+                auto b = bezier_quadratic(corner + f*in, corner, corner + f*out);
+                if (avoids_nodes(b, p.from, p.to)) {
+                    add_segment(p, current, b[0]);
+                    p.points.insert(p.points.end(), b.begin() + 1, b.end());
+                    current = b[3];
+                    rounded = true;
+                    break;
+                }
+            }
+            if (!rounded) {
+                add_segment(p, current, corner);
+                current = corner;
+            }
+        }
+        add_segment(p, current, bends.back());
+        p.curved = true;
+    }
+
+    // adds a straight segment to the curve if the points differ
+    void add_segment(path& p, vec2 from, vec2 to) {
+        if (from != to) {
+            auto b = bezier_line(from, to);
+            p.points.insert(p.points.end(), b.begin() + 1, b.end());
+        }
+    }
+
+    // checks that the curve <b> doesn't intersect any node other than <from> and <to>
+    bool avoids_nodes(const bezier& b, vertex_t from, vertex_t to) const {
+        // the curve is not longer than its control polygon
+        float length = distance(b[0], b[1]) + distance(b[1], b[2]) + distance(b[2], b[3]);
+        int count = std::max(2, int(std::ceil(length/check_step)));
+
+        for (int i = 1; i < count; ++i) {
+            vec2 p = bezier_point(b, float(i)/count);
+
+            // the layer closest to the point
+            auto it = std::lower_bound(layer_y.begin(), layer_y.end(), p.y);
+            if (it == layer_y.end() || (it != layer_y.begin() && p.y - *std::prev(it) < *it - p.y)) {
+                --it;
+            }
+            if (std::abs(*it - p.y) > reach.y)
+                continue;
+
+            // the nodes of the layer are ordered by their x coordinates
+            const auto& layer = h->layers[it - layer_y.begin()];
+            auto u = std::lower_bound(layer.begin(), layer.end(), p.x - reach.x, [this] (vertex_t u, float x) {
+                return nodes[u].pos.x < x;
+            });
+            for (; u != layer.end() && nodes[*u].pos.x <= p.x + reach.x; ++u) {
+                if (*u != from && *u != to && !h->g.is_dummy(*u) && contains(nodes[*u], p)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+};
+
 } // namespace detail
 
 } // namespace drag
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include <drag/types.hpp>
+#include <drag/vec2.hpp>
+
+namespace drag {
+
+namespace detail {
+
+/**
+ * Is the node <n> a circle with the radius n.size?
+ */
+inline bool is_circle(const node& n) {
+    return n.shape == node_shape::ellipse && n.half_size.x == n.half_size.y;
+}
+
+/**
+ * The radius of the smallest circle containing a node of the given shape and half size.
+ */
+inline float enclosing_radius(vec2 half_size, node_shape shape) {
+    if (shape == node_shape::rectangle)
+        return magnitude(half_size);
+    return std::max(half_size.x, half_size.y);
+}
+
+/**
+ * Finds the point where the ray from the point <from> inside of the node <n> in the direction <dir> leaves the node.
+ */
+inline vec2 exit_point(const node& n, vec2 from, vec2 dir) {
+    vec2 f = from - n.pos;
+    vec2 h = n.half_size;
+
+    if (n.shape == node_shape::rectangle) {
+        float t = std::numeric_limits<float>::infinity();
+        if (dir.x != 0) t = std::min(t, ((dir.x > 0 ? h.x : -h.x) - f.x)/dir.x);
+        if (dir.y != 0) t = std::min(t, ((dir.y > 0 ? h.y : -h.y) - f.y)/dir.y);
+        return from + std::max(0.0f, t)*dir;
+    }
+
+    // the ellipse is a unit circle after scaling the coordinates by the half size
+    vec2 fs = { f.x/h.x, f.y/h.y };
+    vec2 ds = { dir.x/h.x, dir.y/h.y };
+    float a = dot(ds, ds);
+    float b = 2*dot(fs, ds);
+    float c = dot(fs, fs) - 1;
+    float t = (-b + std::sqrt(std::max(0.0f, b*b - 4*a*c)))/(2*a);
+    return from + std::max(0.0f, t)*dir;
+}
+
+/**
+ * The point on the border of the node <n> in the direction <dir> from its center.
+ */
+inline vec2 border_point(const node& n, vec2 dir) {
+    return exit_point(n, n.pos, dir);
+}
+
+/**
+ * The distance of the border of the node <n> from the horizontal line through its center
+ * at the horizontal offset <dx> from the center, 0 outside of the node.
+ */
+inline float border_height(const node& n, float dx) {
+    if (n.shape == node_shape::rectangle)
+        return std::abs(dx) <= n.half_size.x ? n.half_size.y : 0;
+    float r = n.half_size.x;
+    if (r == 0)
+        return 0;
+    return std::sqrt(std::max(0.0f, r*r - dx*dx)) * (n.half_size.y / r);
+}
+
+/**
+ * Does the node <n> contain the point <p>?
+ */
+inline bool contains(const node& n, vec2 p) {
+    if (is_circle(n))
+        return distance(p, n.pos) < n.size;
+    vec2 d = p - n.pos;
+    return std::abs(d.y) < border_height(n, d.x);
+}
+
+} // namespace detail
+
+} // namespace drag
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <cmath>
+
+#include <drag/vec2.hpp>
+
+namespace drag {
+
+namespace detail {
+
+/**
+ * Control points of a cubic Bézier curve.
+ */
+using bezier = std::array<vec2, 4>;
+
+/**
+ * Evaluates the cubic Bézier curve <b> at the parameter <t>.
+ */
+inline vec2 bezier_point(const bezier& b, float t) {
+    float s = 1 - t;
+    return s*s*s*b[0] + 3*s*s*t*b[1] + 3*s*t*t*b[2] + t*t*t*b[3];
+}
+
+/**
+ * The straight line from <from> to <to> as a cubic Bézier curve.
+ */
+inline bezier bezier_line(vec2 from, vec2 to) {
+    return { from, from + (1/3.0f)*(to - from), from + (2/3.0f)*(to - from), to };
+}
+
+/**
+ * The quadratic Bézier curve with the control points <from>, <control>, <to> as a cubic one.
+ */
+inline bezier bezier_quadratic(vec2 from, vec2 control, vec2 to) {
+    return { from, from + (2/3.0f)*(control - from), to + (2/3.0f)*(control - to), to };
+}
+
+/**
+ * Removes the points of the poly-line which lie on the straight line between their neighbours.
+ */
+inline void remove_collinear(std::vector<vec2>& points) {
+    const float eps = 1e-3;
+
+    size_t k = 0;
+    for (size_t i = 0; i < points.size(); ++i) {
+        if (k > 0 && distance(points[k - 1], points[i]) < eps) {
+            // keep the endpoints exact
+            if (k > 1) points[k - 1] = points[i];
+            continue;
+        }
+        if (k > 1) {
+            vec2 a = points[k - 1] - points[k - 2];
+            vec2 b = points[i] - points[k - 1];
+            if (std::abs(cross(a, b)) < eps*magnitude(a)*magnitude(b) && dot(a, b) > 0) {
+                --k;
+            }
+        }
+        points[k++] = points[i];
+    }
+    points.resize(k);
+}
+
+} // namespace detail
+
+} // namespace drag
@@ -5,7 +5,6 @@
 
 #include <vector>
 #include <algorithm>
-#include <map>
 #include <numeric> // iota
 
 #include <drag/detail/utils.hpp>
@@ -87,6 +86,7 @@ public:
         return std::find(out.begin(), out.end(), e.to) != out.end();
     }
     bool has_edge(vertex_t u, vertex_t v) const { return has_edge( { u, v } ); }
+    bool has_loop(vertex_t u) const { return m_source.has_loop(u); }
 
     const std::vector<vertex_t>& out_neighbours(vertex_t u) const { return m_source.out_neighbours(u); }
     const std::vector<vertex_t>& in_neighbours(vertex_t u) const { return m_source.in_neighbours(u); }
@@ -216,9 +216,6 @@ struct edge_set {
     }
 };
 
-// FOR DEBUG PURPOUSES
-inline std::map<vertex_t, std::string> debug_labels;
-
 } //namespace detail
 
 } //namespace drag
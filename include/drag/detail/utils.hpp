@@ -2,6 +2,7 @@
 
 #include <string>
 #include <vector>
+#include <chrono>
 
 #include <drag/vec2.hpp>
 #include <drag/types.hpp>
@@ -12,6 +13,23 @@ template <typename T>
 T sgn(T val) { return ( T(0) < val ) - ( val < T(0) ); }
 
 
+/**
+ * Measures the time between consecutive laps.
+ */
+struct stopwatch {
+    using clock = std::chrono::steady_clock;
+    clock::time_point start = clock::now();
+
+    // returns the time since the last lap and starts a new one
+    clock::duration lap() {
+        auto now = clock::now();
+        auto elapsed = now - start;
+        start = now;
+        return elapsed;
+    }
+};
+
+
 template<typename T>
 struct range {
     T r_start;
@@ -0,0 +1,494 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <drag/graph.hpp>
+#include <drag/types.hpp>
+#include <drag/detail/mapped_file.hpp>
+
+namespace drag {
+
+/**
+ * Graph read from the DOT format together with the names of its vertices.
+ */
+struct dot_graph {
+    graph g;
+    std::vector<std::string> names;  /**< the identifier of each vertex in the input */
+    float font_size = 0;             /**< the fontsize attribute of the graph, 0 if it was not set */
+};
+
+namespace detail {
+
+/**
+ * Hash table assigning consecutive identifiers to names.
+ *
+ * Each slot of the open addressing table holds the hash and the first bytes of a name together
+ * with its identifier. The names shorter than 8 characters are compared only within the slot,
+ * so looking them up takes a single access to memory outside of the cache.
+ */
+class name_table {
+    struct slot {
+        std::uint64_t prefix;  // the first 8 bytes, or the whole name and its length if it is shorter
+        std::uint32_t hash;
+        std::uint32_t id;      // the identifier + 1, 0 if the slot is empty
+    };
+
+    std::vector<std::string_view> m_names;
+    std::vector<slot> m_slots;
+    std::uint32_t m_mask = 0;
+
+    static std::uint32_t hash(std::string_view name) {
+        std::uint64_t h = 14695981039346656037ull;
+        for (char c : name) {
+            h = (h ^ (unsigned char)c) * 1099511628211ull;
+        }
+        return std::uint32_t(h ^ (h >> 32));
+    }
+
+    static std::uint64_t prefix(std::string_view name) {
+        char bytes[8] = {};
+        std::memcpy(bytes, name.data(), std::min<size_t>(name.size(), 8));
+        if (name.size() < 8) {
+            bytes[7] = char(name.size());
+        }
+        std::uint64_t p;
+        std::memcpy(&p, bytes, 8);
+        return p;
+    }
+
+    void rehash(size_t capacity) {
+        std::vector<slot> old(capacity, slot{ 0, 0, 0 });
+        std::swap(old, m_slots);
+        m_mask = capacity - 1;
+        for (const auto& s : old) {
+            if (s.id != 0) {
+                auto i = s.hash & m_mask;
+                while (m_slots[i].id != 0) {
+                    i = (i + 1) & m_mask;
+                }
+                m_slots[i] = s;
+            }
+        }
+    }
+
+public:
+    explicit name_table(size_t expected = 0) {
+        size_t capacity = 16;
+        while (capacity < 2*expected) {
+            capacity *= 2;
+        }
+        m_names.reserve(expected);
+        rehash(capacity);
+    }
+
+    /**
+     * Returns the identifier of the name, a new one if it has not been seen yet.
+     * The name has to outlive the table.
+     */
+    vertex_t insert(std::string_view name) {
+        auto h = hash(name);
+        auto p = prefix(name);
+        auto i = h & m_mask;
+        for (; m_slots[i].id != 0; i = (i + 1) & m_mask) {
+            const auto& s = m_slots[i];
+            if (s.hash == h && s.prefix == p && (name.size() < 8 || m_names[s.id - 1] == name)) {
+                return s.id - 1;
+            }
+        }
+
+        vertex_t id = m_names.size();
+        m_names.push_back(name);
+        m_slots[i] = slot{ p, h, id + 1 };
+        // keep the table at most half full
+        if (2*m_names.size() > m_slots.size()) {
+            rehash(2*m_slots.size());
+        }
+        return id;
+    }
+
+    size_t size() const { return m_names.size(); }
+    const std::vector<std::string_view>& names() const { return m_names; }
+};
+
+/**
+ * Parser of a subset of the DOT language.
+ *
+ * Supported are graph attributes (`a = b` statements and `graph [...]`), node statements with
+ * attribute lists and chains of edges `a -> b -> c`. Subgraphs and ports are not supported,
+ * the attributes of edges and the default attributes of nodes and edges are ignored.
+ *
+ * The input is scanned once without copying. The identifiers are views into it and they are
+ * mapped to the vertices by a name_table, the edges are collected in a single array and the
+ * graph is built from it at the end by graph::from_edge_list(), which also drops repeated edges.
+ */
+class dot_parser {
+    enum class token_kind { id, edge_op, lbrace, rbrace, lbracket, rbracket, equals, semicolon, comma, colon, end };
+
+    struct token {
+        token_kind kind;
+        std::string_view text;
+    };
+
+    struct node_attributes {
+        vertex_t u;
+        vec2 size;
+        node_shape shape;
+    };
+
+    std::string_view m_text;
+    size_t m_pos = 0;
+    int m_line = 1;
+    token m_next;
+
+    name_table m_ids;
+    std::vector< std::pair<vertex_t, vertex_t> > m_edges;
+    std::vector<node_attributes> m_sizes;
+    drag::attributes m_attributes;  // the graph attributes, set on the graph once it is built
+
+    dot_graph m_result;
+
+public:
+    // the sizes of the tables are rough estimates of the size of the graph to avoid growing them
+    explicit dot_parser(std::string_view text) : m_text(text), m_ids(text.size() / 64) {
+        m_edges.reserve(text.size() / 24);
+    }
+
+    dot_graph parse() {
+        advance();
+        if (is_keyword(m_next, "strict")) {
+            advance();
+        }
+
+        if (is_keyword(m_next, "digraph") || is_keyword(m_next, "graph")) {
+            advance();
+            if (m_next.kind == token_kind::id) {
+                advance();
+            }
+            expect(token_kind::lbrace, "'{'");
+            statements(token_kind::rbrace);
+            advance();
+        } else {
+            // plain list of statements without the header
+            statements(token_kind::end);
+        }
+
+        if (m_next.kind != token_kind::end) {
+            error("Expected the end of the input");
+        }
+        build();
+        return std::move(m_result);
+    }
+
+private:
+    void statements(token_kind last) {
+        while (m_next.kind != last) {
+            if (m_next.kind == token_kind::end) {
+                error("Unexpected end of the input");
+            }
+            statement();
+            if (m_next.kind == token_kind::semicolon || m_next.kind == token_kind::comma) {
+                advance();
+            }
+        }
+    }
+
+    void statement() {
+        if (m_next.kind == token_kind::lbrace || is_keyword(m_next, "subgraph")) {
+            error("Subgraphs are not supported");
+        }
+        token first = expect(token_kind::id, "an identifier");
+
+        if (m_next.kind == token_kind::equals) {
+            advance();
+            token value = expect(token_kind::id, "a value");
+            graph_attribute(first.text, value.text);
+            return;
+        }
+
+        if (is_keyword(first, "graph")) {
+            attributes([this] (std::string_view key, std::string_view value) { graph_attribute(key, value); });
+            return;
+        }
+        if (is_keyword(first, "node") || is_keyword(first, "edge")) {
+            attributes([] (std::string_view, std::string_view) {});
+            return;
+        }
+
+        if (m_next.kind == token_kind::colon) {
+            error("Ports are not supported");
+        }
+
+        vertex_t u = vertex(first.text);
+        if (m_next.kind != token_kind::edge_op) {
+            node_statement(u);
+            return;
+        }
+
+        while (m_next.kind == token_kind::edge_op) {
+            advance();
+            vertex_t v = vertex(expect(token_kind::id, "an identifier").text);
+            m_edges.emplace_back(u, v);
+            u = v;
+        }
+        attributes([] (std::string_view, std::string_view) {});
+    }
+
+    void node_statement(vertex_t u) {
+        if (m_next.kind != token_kind::lbracket) {
+            return;
+        }
+
+        node_attributes attr{ u, { 0, 0 }, node_shape::ellipse };
+        bool sized = false;
+        attributes([this, &attr, &sized] (std::string_view key, std::string_view value) {
+            if (key == "width") {
+                attr.size.x = to_size(value);
+                sized = true;
+            } else if (key == "height") {
+                attr.size.y = to_size(value);
+                sized = true;
+            } else if (key == "shape") {
+                attr.shape = value == "box" || value == "rect" || value == "rectangle" ? node_shape::rectangle : node_shape::ellipse;
+                sized = true;
+            }
+        });
+        if (sized) {
+            m_sizes.push_back(attr);
+        }
+    }
+
+    // reads the attribute lists [a=b, c=d][e=f] and passes the pairs to <use>
+    template<typename Use>
+    void attributes(Use use) {
+        while (m_next.kind == token_kind::lbracket) {
+            advance();
+            while (m_next.kind != token_kind::rbracket) {
+                token key = expect(token_kind::id, "an attribute name");
+                expect(token_kind::equals, "'='");
+                token value = expect(token_kind::id, "an attribute value");
+                use(key.text, value.text);
+                if (m_next.kind == token_kind::comma || m_next.kind == token_kind::semicolon) {
+                    advance();
+                }
+            }
+            advance();
+        }
+    }
+
+    void graph_attribute(std::string_view key, std::string_view value) {
+        drag::attributes& g = m_attributes;
+        if (key == "ranksep") {
+            g.layer_dist = to_float(value);
+        } else if (key == "nodesep") {
+            g.node_dist = to_float(value);
+        } else if (key == "nodesize") {
+            g.node_size = to_float(value);
+        } else if (key == "fontsize") {
+            m_result.font_size = to_float(value);
+        } else if (key == "loopangle") {
+            g.loop_angle = to_float(value);
+        } else if (key == "loopsize") {
+            g.loop_size = to_float(value);
+        } else if (key == "concentrate") {
+            g.concentrate = value == "true";
+        } else if (key == "splines") {
+            if (value == "ortho") {
+                g.routing = edge_routing::orthogonal;
+            } else if (value == "spline" || value == "true") {
+                g.routing = edge_routing::spline;
+            } else {
+                g.routing = edge_routing::polyline;
+            }
+        }
+    }
+
+    vertex_t vertex(std::string_view name) { return m_ids.insert(name); }
+
+    void build() {
+        graph& g = m_result.g;
+        g = graph::from_edge_list(m_edges, m_ids.size());
+        g.node_size = m_attributes.node_size;
+        g.node_dist = m_attributes.node_dist;
+        g.layer_dist = m_attributes.layer_dist;
+        g.loop_angle = m_attributes.loop_angle;
+        g.loop_size = m_attributes.loop_size;
+        g.routing = m_attributes.routing;
+        g.concentrate = m_attributes.concentrate;
+
+        for (const auto& attr : m_sizes) {
+            vec2 dim = g.node_dimensions(attr.u);
+            g.set_node_size(attr.u, attr.size.x == 0 ? dim.x : attr.size.x, attr.size.y == 0 ? dim.y : attr.size.y, attr.shape);
+        }
+
+        m_result.names.reserve(m_ids.size());
+        for (auto name : m_ids.names()) {
+            m_result.names.emplace_back(name);
+        }
+    }
+
+    float to_float(std::string_view value) const {
+        float x = 0;
+        auto [ end, ec ] = std::from_chars(value.data(), value.data() + value.size(), x);
+        if (ec != std::errc() || end != value.data() + value.size()) {
+            error("Expected a number instead of '" + std::string(value) + "'");
+        }
+        return x;
+    }
+
+    // the width or height of a node, which has to be a finite non-negative number
+    float to_size(std::string_view value) const {
+        float x = to_float(value);
+        if (!std::isfinite(x) || x < 0) {
+            error("Expected a non-negative size instead of '" + std::string(value) + "'");
+        }
+        return x;
+    }
+
+    token expect(token_kind kind, const char* what) {
+        if (m_next.kind != kind) {
+            error(std::string("Expected ") + what);
+        }
+        token t = m_next;
+        advance();
+        return t;
+    }
+
+    static bool is_keyword(const token& t, std::string_view word) {
+        if (t.kind != token_kind::id || t.text.size() != word.size())
+            return false;
+        for (size_t i = 0; i < word.size(); ++i) {
+            if ((t.text[i] | 0x20) != word[i])
+                return false;
+        }
+        return true;
+    }
+
+    [[noreturn]] void error(const std::string& message) const {
+        throw std::invalid_argument("line " + std::to_string(m_line) + ": " + message);
+    }
+
+    static bool is_id_char(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+            || c == '_' || c == '.' || c == '-' || (unsigned char)c >= 128;
+    }
+
+    // skips white space and comments
+    void skip_space() {
+        while (m_pos < m_text.size()) {
+            char c = m_text[m_pos];
+            if (c == '\n') {
+                ++m_line;
+                ++m_pos;
+            } else if (c == ' ' || c == '\t' || c == '\r') {
+                ++m_pos;
+            } else if (c == '#' || (c == '/' && m_pos + 1 < m_text.size() && m_text[m_pos + 1] == '/')) {
+                while (m_pos < m_text.size() && m_text[m_pos] != '\n') {
+                    ++m_pos;
+                }
+            } else if (c == '/' && m_pos + 1 < m_text.size() && m_text[m_pos + 1] == '*') {
+                auto end = m_text.find("*/", m_pos + 2);
+                if (end == std::string_view::npos) {
+                    error("Unterminated comment");
+                }
+                for (; m_pos < end + 2; ++m_pos) {
+                    m_line += m_text[m_pos] == '\n';
+                }
+            } else {
+                break;
+            }
+        }
+    }
+
+    void advance() {
+        skip_space();
+        if (m_pos == m_text.size()) {
+            m_next = { token_kind::end, {} };
+            return;
+        }
+
+        size_t start = m_pos;
+        char c = m_text[m_pos];
+        auto single = [this, start] (token_kind kind) {
+            ++m_pos;
+            m_next = { kind, m_text.substr(start, 1) };
+        };
+
+        switch (c) {
+            case '{': return single(token_kind::lbrace);
+            case '}': return single(token_kind::rbrace);
+            case '[': return single(token_kind::lbracket);
+            case ']': return single(token_kind::rbracket);
+            case '=': return single(token_kind::equals);
+            case ';': return single(token_kind::semicolon);
+            case ',': return single(token_kind::comma);
+            case ':': return single(token_kind::colon);
+            default: break;
+        }
+
+        if (c == '-' && m_pos + 1 < m_text.size() && (m_text[m_pos + 1] == '>' || m_text[m_pos + 1] == '-')) {
+            m_pos += 2;
+            m_next = { token_kind::edge_op, m_text.substr(start, 2) };
+            return;
+        }
+
+        if (c == '"') {
+            // the quotes are not part of the identifier, the escape sequences are kept as they are
+            ++m_pos;
+            while (m_pos < m_text.size() && m_text[m_pos] != '"') {
+                if (m_text[m_pos] == '\\') {
+                    ++m_pos;
+                }
+                m_line += m_pos < m_text.size() && m_text[m_pos] == '\n';
+                ++m_pos;
+            }
+            if (m_pos >= m_text.size()) {
+                error("Unterminated string");
+            }
+            ++m_pos;
+            m_next = { token_kind::id, m_text.substr(start + 1, m_pos - start - 2) };
+            return;
+        }
+
+        if (is_id_char(c)) {
+            // a minus sign followed by '>' or '-' is an edge operator and not a part of the identifier
+            while (m_pos < m_text.size() && is_id_char(m_text[m_pos])) {
+                if (m_text[m_pos] == '-' && m_pos + 1 < m_text.size() && (m_text[m_pos + 1] == '>' || m_text[m_pos + 1] == '-'))
+                    break;
+                ++m_pos;
+            }
+            m_next = { token_kind::id, m_text.substr(start, m_pos - start) };
+            return;
+        }
+
+        error(std::string("Unexpected character '") + c + "'");
+    }
+};
+
+} // namespace detail
+
+/**
+ * Parses a graph in a subset of the DOT language, see detail::dot_parser for what is supported.
+ * Throws std::invalid_argument with the line number if the input is not valid.
+ */
+inline dot_graph parse_dot(std::string_view text) {
+    return detail::dot_parser(text).parse();
+}
+
+/**
+ * Reads a graph in the DOT language from the file, which is mapped into memory instead of being copied.
+ */
+inline dot_graph read_dot(const std::string& filename) {
+    detail::mapped_file file(filename);
+    return parse_dot(file.contents());
+}
+
+} // namespace drag
@@ -2,4 +2,6 @@
 
 #include <drag/graph.hpp>
 #include <drag/layout.hpp>
+#include <drag/incremental.hpp>
+#include <drag/metrics.hpp>
 #include <drag/types.hpp>
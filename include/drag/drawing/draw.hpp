@@ -26,41 +26,72 @@ struct drawing_options {
 
 namespace detail {
 
-void draw_edge(svg_image& img, const path& p, const drawing_options& opts, float arrow_size) {
+template<typename Canvas>
+void draw_node(Canvas& img, const node& n, const std::string& color) {
+    if (n.shape == node_shape::rectangle) {
+        img.draw_rectangle(n.pos, n.half_size, color);
+    } else if (n.half_size.x != n.half_size.y) {
+        img.draw_ellipse(n.pos, n.half_size, color);
+    } else {
+        img.draw_circle(n.pos, n.size, color);
+    }
+}
+
+template<typename Canvas, typename Path>
+void draw_edge(Canvas& img, const Path& p, const drawing_options& opts, float arrow_size) {
     // get the color
     auto it = opts.edge_colors.find( {p.from, p.to} );
     const auto& color = it == opts.edge_colors.end() ? "black" : it->second;
 
     // draw the lines
-    img.draw_polyline(p.points, color);
+    if (p.curved) {
+        img.draw_spline(p.points, color);
+    } else {
+        img.draw_polyline(p.points, color);
+    }
 
-    // draw the arrow
+    // draw the arrow, for curves the inner control points give the direction at the ends
     img.draw_arrow(p.points[p.points.size() - 2], p.points.back(), arrow_size, color);
     if (p.bidirectional) {
         img.draw_arrow(p.points[1], p.points.front(), arrow_size, color);
     }
 }
 
-} // namespace detail
-
-svg_image draw_svg_image(const drag::sugiyama_layout& l, const drawing_options& opts) {
-    svg_image img(l.dimensions(), opts.margin);
-
+/**
+ * Draws the nodes and edges of the layout into <img>, which is either an svg_image or an svg_writer.
+ */
+template<typename Canvas>
+void draw_layout(Canvas& img, const drag::sugiyama_layout& l, const drawing_options& opts) {
     for (const auto& node : l.vertices()) {
         const auto& label = opts.labels.count(node.u) ? opts.labels.at(node.u) : std::to_string(node.u);
         const auto& color = opts.colors.count(node.u) ? opts.colors.at(node.u) : "black"; 
-        img.draw_circle(node.pos, l.attribs().node_size, color);
+        draw_node(img, node, color);
         img.draw_text(node.pos, label, opts.font_size, color);
     }
 
     float arrow_size = 0.4 * l.attribs().node_size;
     for (const auto& path : l.edges()) {
-        detail::draw_edge(img, path, opts, arrow_size);
+        draw_edge(img, path, opts, arrow_size);
     }
+}
+
+} // namespace detail
 
+svg_image draw_svg_image(const drag::sugiyama_layout& l, const drawing_options& opts) {
+    svg_image img(l.dimensions(), opts.margin);
+    detail::draw_layout(img, l, opts);
     return img;
 }
 
+/**
+ * Streams the whole svg document with the layout into <out> without building the image in memory.
+ */
+inline void draw_svg_image(svg_writer& out, const drag::sugiyama_layout& l, const drawing_options& opts) {
+    out.begin(l.dimensions(), opts.margin);
+    detail::draw_layout(out, l, opts);
+    out.end();
+}
+
 svg_image draw_svg_image(const graph& g, const drawing_options& opts) {
     sugiyama_layout layout(g);
     return draw_svg_image(layout, opts);
@@ -71,8 +102,9 @@ void draw_svg_file(const std::string& filename,
                    const graph& g,
                    const drawing_options& opts)
 {
-    auto img = draw_svg_image(g, opts);
-    img.save(filename);
+    sugiyama_layout layout(g);
+    svg_writer out(filename);
+    draw_svg_image(out, layout, opts);
 }
 
 } // namespace drag
@@ -1,10 +1,13 @@
 #pragma once
 
-#include <fstream>
+#include <cstdio>
 #include <string>
-#include <sstream>
+#include <string_view>
+#include <vector>
 #include <map>
 #include <array>
+#include <charconv>
+#include <functional>
 #include <stdexcept>
 
 #include <drag/vec2.hpp>
@@ -12,122 +15,324 @@
 
 namespace drag {
 
+namespace detail {
 
-class svg_file;
-
-class svg_image {
+/**
+ * The svg elements, written through the method write of <Out>.
+ * The numbers are formatted the same way as by an output stream with the default precision.
+ */
+template<typename Out>
+class svg_canvas {
 public:
-    svg_image(vec2 size, float margin) 
-        : m_size(size)
-        , m_margin(margin) {}
-
-    svg_image(vec2 size) : svg_image(size, 0) {}
-
-    svg_image() : svg_image({0, 0}, 0) {};
-    
-    void draw_polyline(std::vector<drag::vec2> points, const std::string& color="black") {
-        m_data << "<polyline ";
-        m_data << "points=\"";
+    void draw_polyline(drag::point_range points, const std::string& color="black") {
+        out("<polyline ");
+        out("points=\"");
         
         const char* sep = "";
         for (auto [ x, y ] : points) {
-            m_data << sep << x << " " << y;
+            out(sep, x, " ", y);
             sep = " ";
         }
         
-        m_data << "\" stroke=\"" << color << "\" ";
-        m_data << "fill=\"none\" ";
-        m_data << "/>\n";
+        out("\" stroke=\"", color, "\" ");
+        out("fill=\"none\" ");
+        out("/>\n");
+    }
+
+    /**
+     * Draws a cubic Bézier spline given by the points [p0, c1, c2, p1, c1, c2, p2, ...].
+     */
+    void draw_spline(drag::point_range points, const std::string& color="black") {
+        out("<path ");
+        out("d=\"M ", points[0].x, " ", points[0].y);
+        for (size_t i = 1; i < points.size(); ++i) {
+            out((i % 3 == 1) ? " C " : " ", points[i].x, " ", points[i].y);
+        }
+        out("\" stroke=\"", color, "\" ");
+        out("fill=\"none\" ");
+        out("/>\n");
     }
 
     void draw_circle(drag::vec2 center, float r, const std::string& color="black") {
-        m_data << "<circle ";
-        m_data << "cx=\"" << center.x << "\" ";
-        m_data << "cy=\"" << center.y << "\" ";
-        m_data << "r=\"" << r << "\" ";
-        m_data << "stroke=\"" << color << "\" ";
-        m_data << "stroke-width=\"1\" ";
-        m_data << "fill=\"white\" ";
-        m_data << "/>\n";
+        out("<circle ");
+        out("cx=\"", center.x, "\" ");
+        out("cy=\"", center.y, "\" ");
+        out("r=\"", r, "\" ");
+        out("stroke=\"", color, "\" ");
+        out("stroke-width=\"1\" ");
+        out("fill=\"white\" ");
+        out("/>\n");
+    }
+
+    void draw_ellipse(drag::vec2 center, drag::vec2 radii, const std::string& color="black") {
+        out("<ellipse ");
+        out("cx=\"", center.x, "\" ");
+        out("cy=\"", center.y, "\" ");
+        out("rx=\"", radii.x, "\" ");
+        out("ry=\"", radii.y, "\" ");
+        out("stroke=\"", color, "\" ");
+        out("stroke-width=\"1\" ");
+        out("fill=\"white\" ");
+        out("/>\n");
+    }
+
+    void draw_rectangle(drag::vec2 center, drag::vec2 half_size, const std::string& color="black") {
+        out("<rect ");
+        out("x=\"", center.x - half_size.x, "\" ");
+        out("y=\"", center.y - half_size.y, "\" ");
+        out("width=\"", 2*half_size.x, "\" ");
+        out("height=\"", 2*half_size.y, "\" ");
+        out("stroke=\"", color, "\" ");
+        out("stroke-width=\"1\" ");
+        out("fill=\"white\" ");
+        out("/>\n");
     }
 
     void draw_text(drag::vec2 pos, const std::string& text, float size, const std::string& color="black") {
-        m_data << "<text ";
-        m_data << "x=\"" << pos.x << "\" ";
-        m_data << "y=\"" << pos.y << "\" ";
-        m_data << "fill=\"" << color << "\" ";
-        m_data << "dominant-baseline=\"middle\" ";
-        m_data << "text-anchor=\"middle\" ";
-        m_data << "font-size=\"" << size << "\" font-family=\"Times,serif\" ";
-        m_data << ">";
-        m_data << text;
-        m_data << "</text>\n";
+        out("<text ");
+        out("x=\"", pos.x, "\" ");
+        out("y=\"", pos.y, "\" ");
+        out("fill=\"", color, "\" ");
+        out("dominant-baseline=\"middle\" ");
+        out("text-anchor=\"middle\" ");
+        out("font-size=\"", size, "\" font-family=\"Times,serif\" ");
+        out(">");
+        out(text);
+        out("</text>\n");
     }
 
     void draw_polygon(const std::vector<drag::vec2>& points, const std::string& color = "black") {
-        m_data << "<polygon ";
-        m_data << "points=\"";
-        for (auto p : points) {
-            m_data << p.x << "," << p.y << " ";
-        }
-        m_data << "\" ";
-        m_data << "stroke=\"" << color << "\" ";
-        m_data << "fill=\"" << color << "\" ";
-        m_data << "/>\n";
+        polygon(points.begin(), points.end(), color);
     }
 
     void draw_arrow(drag::vec2 from, drag::vec2 to, float size, const std::string& color = "black") {
         auto dir = from - to;
         dir = normalized(dir);
-        draw_polygon( { to, to + size * rotate(dir, 20), to + size * rotate(dir, -20) }, color );
+        std::array<drag::vec2, 3> points = { to, to + size * rotate(dir, 20), to + size * rotate(dir, -20) };
+        polygon(points.begin(), points.end(), color);
     }
 
-    void add_image(const svg_image& img) {
-        m_data << "<g transform='translate(" << m_size.x + img.m_margin << ", " << img.m_margin << ")'>\n";
-        m_data << img.m_data.str();
-        m_data << "</g>\n";
+protected:
+    // writes all the arguments one after another
+    template<typename... Args>
+    void out(const Args&... args) {
+        (put(args), ...);
+    }
 
-        m_size.x += img.m_size.x + 2*img.m_margin; 
-        m_size.y = std::max(m_size.y, img.m_size.y + 2*img.m_margin); 
+    // the beginning of the document up to the group containing the image
+    void header(vec2 size, float margin) {
+        float w = size.x + 2*margin;
+        float h = size.y + 2*margin;
+
+        out("<svg xmlns='http://www.w3.org/2000/svg'\n");
+        out("\twidth='", w, "pt' height='", h, "pt'\n");
+        out("\tviewBox='0 0 ", size.x + 2*margin, " ", size.y + 2*margin, "'>\n");
+        
+        // draw a background polygon
+        out("<polygon fill='white' stroke='transparent' ");
+        out("points='");
+        out("0,0 ");
+        out("0,", h, " ");
+        out(w, ",", h, " ");
+        out(w, ",0");
+        out("'/>\n");
+        
+        out("<g transform='translate(", margin, ", ", margin, ")'>\n");
     }
 
-    void save(const std::string& filename) const {
-        std::ofstream file(filename);
+    void footer() {
+        out("</g>\n");
+        out("</svg>\n");
+    }
+
+private:
+    template<typename It>
+    void polygon(It first, It last, const std::string& color) {
+        out("<polygon ");
+        out("points=\"");
+        for (; first != last; ++first) {
+            out(first->x, ",", first->y, " ");
+        }
+        out("\" ");
+        out("stroke=\"", color, "\" ");
+        out("fill=\"", color, "\" ");
+        out("/>\n");
+    }
+
+    void put(std::string_view text) { static_cast<Out*>(this)->write(text); }
+    void put(const char* text) { put(std::string_view(text)); }
+    void put(const std::string& text) { put(std::string_view(text)); }
+
+    void put(float x) {
+        std::array<char, 32> buffer;
+        auto end = std::to_chars(buffer.data(), buffer.data() + buffer.size(), x, std::chars_format::general, 6).ptr;
+        put(std::string_view(buffer.data(), end - buffer.data()));
+    }
+};
+
+} // namespace detail
+
+
+class svg_file;
 
+/**
+ * Destination of the data written by svg_writer, receives it in chunks.
+ */
+using svg_sink = std::function< void(const char* data, size_t size) >;
+
+/**
+ * Streams an svg image to a file or a sink through a fixed-size buffer,
+ * so the whole image is never held in memory.
+ *
+ * The header of the document is written by begin and the end of it by end.
+ * The elements are drawn in between in the same way as into svg_image.
+ *
+ * Errors of the sink reach the caller only from write, end and flush.
+ * The destructor flushes what is left but ignores the errors,
+ * so call end or flush to know that everything was written.
+ */
+class svg_writer : public detail::svg_canvas<svg_writer> {
+public:
+    explicit svg_writer(svg_sink sink)
+        : m_sink(std::move(sink))
+        , m_buffer(buffer_size) {}
+
+    /**
+     * Writes into an already open file, which is left open.
+     */
+    explicit svg_writer(std::FILE* file) : svg_writer(file, false) {}
+
+    /**
+     * Creates the file <filename> and writes into it.
+     */
+    explicit svg_writer(const std::string& filename) : svg_writer(open(filename), true) {}
+
+    svg_writer(const svg_writer&) = delete;
+    svg_writer& operator=(const svg_writer&) = delete;
+
+    ~svg_writer() {
+        try {
+            flush();
+        } catch (...) {}
+        if (m_owned) {
+            std::fclose(m_owned);
+        }
+    }
+
+    /**
+     * Writes the beginning of a document with an image of the given size and margin around it.
+     */
+    void begin(vec2 size, float margin) { header(size, margin); }
+
+    /**
+     * Writes the end of the document.
+     */
+    void end() {
+        footer();
+        flush();
+    }
+
+    /**
+     * Writes the text as it is.
+     */
+    void write(std::string_view text) {
+        if (text.size() > m_buffer.size() - m_used) {
+            flush();
+            if (text.size() > m_buffer.size()) {
+                m_sink(text.data(), text.size());
+                return;
+            }
+        }
+        std::copy(text.begin(), text.end(), m_buffer.begin() + m_used);
+        m_used += text.size();
+    }
+
+    /**
+     * Passes the buffered data to the sink, and when writing into a file, flushes the file as well.
+     * The buffer is emptied even if the sink throws.
+     */
+    void flush() {
+        if (m_used > 0) {
+            size_t used = m_used;
+            m_used = 0;
+            m_sink(m_buffer.data(), used);
+        }
+        if (m_file && (std::fflush(m_file) != 0 || std::ferror(m_file))) {
+            throw std::runtime_error("Failed to write svg image into a file.");
+        }
+    }
+
+private:
+    static const size_t buffer_size = 1 << 16;
+
+    svg_sink m_sink;
+    std::vector<char> m_buffer;
+    size_t m_used = 0;
+    std::FILE* m_file = nullptr;   // the file written by the sink, if any
+    std::FILE* m_owned = nullptr;  // the file to be closed by the destructor
+
+    svg_writer(std::FILE* file, bool owned)
+        : svg_writer([file] (const char* data, size_t size) {
+            if (std::fwrite(data, 1, size, file) != size) {
+                throw std::runtime_error("Failed to write svg image into a file.");
+            }
+        })
+    {
+        m_file = file;
+        if (owned) {
+            m_owned = file;
+        }
+    }
+
+    static std::FILE* open(const std::string& filename) {
+        std::FILE* file = std::fopen(filename.c_str(), "wb");
         if (!file) {
             throw std::invalid_argument("Failed to save svg immage. Cannot open file '" + filename + "'");
         }
+        return file;
+    }
+
+    friend svg_file;
+};
 
-        float w = m_size.x + 2*m_margin;
-        float h = m_size.y + 2*m_margin;
 
-        file << "<svg xmlns='http://www.w3.org/2000/svg'\n";
-        file << "\twidth='" << w << "pt' height='" << h << "pt'\n";
-        file << "\tviewBox='0 0 " << m_size.x + 2*m_margin << " " << m_size.y + 2*m_margin << "'>\n";
-        
-        // draw a background polygon
-        file << "<polygon fill='white' stroke='transparent' ";
-        file << "points='";
-        file << "0,0 ";
-        file << "0," << h << " ";
-        file << w << "," << h << " ";
-        file << w << ",0";
-        file << "'/>\n";
-        
-        file << "<g transform='translate(" << m_margin << ", " << m_margin << ")'>\n";
-        
-        file << m_data.str();
+/**
+ * Svg image kept in memory, which can be saved or added to another image.
+ */
+class svg_image : public detail::svg_canvas<svg_image> {
+public:
+    svg_image(vec2 size, float margin) 
+        : m_size(size)
+        , m_margin(margin) {}
+
+    svg_image(vec2 size) : svg_image(size, 0) {}
+
+    svg_image() : svg_image({0, 0}, 0) {};
+
+    void add_image(const svg_image& img) {
+        out("<g transform='translate(", m_size.x + img.m_margin, ", ", img.m_margin, ")'>\n");
+        out(img.m_data);
+        out("</g>\n");
 
-        file << "</g>\n";
+        m_size.x += img.m_size.x + 2*img.m_margin; 
+        m_size.y = std::max(m_size.y, img.m_size.y + 2*img.m_margin); 
+    }
 
-        file << "</svg>\n";
+    void save(const std::string& filename) const {
+        svg_writer file(filename);
+        file.begin(m_size, m_margin);
+        file.write(m_data);
+        file.end();
     }
 
 private:
-    std::stringstream m_data;
+    std::string m_data;
     vec2 m_size;
     float m_margin;
 
+    void write(std::string_view text) { m_data.append(text); }
+
+    friend detail::svg_canvas<svg_image>;
     friend svg_file;
 };
 
@@ -135,24 +340,26 @@ private:
 class svg_file {
 public:
     svg_file(const std::string& filename) : m_file(filename) {
-        m_file << "<svg xmlns='http://www.w3.org/2000/svg'>\n";
+        m_file.write("<svg xmlns='http://www.w3.org/2000/svg'>\n");
     }
 
     ~svg_file() {
-        m_file << "</svg>\n";
+        try {
+            m_file.write("</svg>\n");
+        } catch (...) {}
     }
 
     void add_image(const svg_image& img) {
-        m_file << "<g transform='translate(" << m_size.x + img.m_margin << ", " << img.m_margin << ")'>\n";
-        m_file << img.m_data.str();
-        m_file << "</g>\n";
+        m_file.out("<g transform='translate(", m_size.x + img.m_margin, ", ", img.m_margin, ")'>\n");
+        m_file.write(img.m_data);
+        m_file.write("</g>\n");
 
         m_size.x += img.m_size.x + 2*img.m_margin; 
         m_size.y = std::max(m_size.y, img.m_size.y + 2*img.m_margin); 
     }
 
 private:
-    std::ofstream m_file;
+    svg_writer m_file;
     vec2 m_size = { 0, 0 };
 };
 
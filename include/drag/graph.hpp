@@ -7,6 +7,7 @@
 #include <set>
 #include <tuple>
 #include <map>
+#include <limits>
 
 #include <drag/types.hpp>
 #include <drag/detail/utils.hpp>
@@ -20,11 +21,13 @@ namespace drag {
 class graph {
 public:
 
-    float node_size = 25;         /**< radius of all nodes */
+    float node_size = 25;         /**< radius of the nodes without an explicit size */
     float node_dist = 20;         /**< minimum distance between borders of 2 nodes */
     float layer_dist = 40;        /**< minimum distance between borders of nodes in 2 different layers */
     float loop_angle = 55;        /**< angle determining the point on the node where a loop connects to it */
     float loop_size = node_size;  /**< distance which the loop extends from the node*/
+    edge_routing routing = edge_routing::polyline; /**< how the edges are routed */
+    bool concentrate = false;     /**< merge long edges with a common endpoint until they diverge */
 
     /**
      * Add a new vertex to the graph.
@@ -42,6 +45,7 @@ public:
      * 
      * The behavious is undefined if the same edge is added twice 
      * or if an identifier other then one returned by add_node() is used.
+     * A list of edges which may contain duplicates can be turned into a graph by from_edge_list().
      * 
      * @param from the identifier of the starting vertex
      * @param to   the identifier of the ending vertex
@@ -51,9 +55,109 @@ public:
     graph& add_edge(vertex_t from, vertex_t to) { 
         m_out_neighbours[from].push_back(to);
         m_in_neighbours[to].push_back(from);
+        if (from == to) {
+            set_loop(from, true);
+        }
         return *this;
     }
 
+    /**
+     * Create a graph from the edges in the range [<first>, <last>) of pairs of vertices.
+     * 
+     * The graph has the vertices `0 ... n-1`, where `n` is the larger of <node_count>
+     * and one more than the largest identifier in the edges.
+     * The degrees of all vertices are counted first so that every list of neighbours
+     * is allocated only once. If an edge is given more than once, only its first
+     * occurrence is kept, otherwise the neighbours are in the order of the edges.
+     * Loops are tagged, see has_loop().
+     */
+    template<typename It>
+    static graph from_edge_list(It first, It last, unsigned node_count = 0) {
+        std::vector<unsigned> out_degree(node_count);
+        std::vector<unsigned> in_degree(node_count);
+        for (auto it = first; it != last; ++it) {
+            auto [ u, v ] = *it;
+            if (std::max(u, v) >= out_degree.size()) {
+                out_degree.resize(std::max(u, v) + 1);
+                in_degree.resize(std::max(u, v) + 1);
+            }
+            ++out_degree[u];
+            ++in_degree[v];
+        }
+
+        graph g;
+        unsigned n = out_degree.size();
+        g.m_out_neighbours.resize(n);
+        g.m_in_neighbours.resize(n);
+        for (vertex_t u = 0; u < n; ++u) {
+            g.m_out_neighbours[u].reserve(out_degree[u]);
+            g.m_in_neighbours[u].reserve(in_degree[u]);
+        }
+
+        for (auto it = first; it != last; ++it) {
+            auto [ u, v ] = *it;
+            g.m_out_neighbours[u].push_back(v);
+            g.m_in_neighbours[v].push_back(u);
+            if (u == v) {
+                g.set_loop(u, true);
+            }
+        }
+
+        // keep the first occurrence of each neighbour, the in lists only need to be checked if there was a duplicate
+        std::vector<vertex_t> seen(n, std::numeric_limits<vertex_t>::max());
+        bool duplicates = false;
+        for (vertex_t u = 0; u < n; ++u) {
+            duplicates |= remove_duplicates(g.m_out_neighbours[u], seen, u);
+        }
+        if (duplicates) {
+            std::fill(seen.begin(), seen.end(), std::numeric_limits<vertex_t>::max());
+            for (vertex_t u = 0; u < n; ++u) {
+                remove_duplicates(g.m_in_neighbours[u], seen, u);
+            }
+        }
+
+        return g;
+    }
+
+    static graph from_edge_list(const std::vector< std::pair<vertex_t, vertex_t> >& edges, unsigned node_count = 0) {
+        return from_edge_list(edges.begin(), edges.end(), node_count);
+    }
+
+    /**
+     * Does the vertex <u> have a loop?
+     */
+    bool has_loop(vertex_t u) const { return u < m_loops.size() && m_loops[u]; }
+
+    /**
+     * Set the width and height of the vertex <u> and its shape.
+     * The vertices without an explicit size are circles with the radius node_size.
+     */
+    void set_node_size(vertex_t u, float width, float height, node_shape shape = node_shape::rectangle) {
+        if (m_node_sizes.size() <= u) {
+            m_node_sizes.resize(u + 1, { 0, 0 });
+            m_node_shapes.resize(u + 1, node_shape::ellipse);
+        }
+        m_node_sizes[u] = { width, height };
+        m_node_shapes[u] = shape;
+    }
+
+    /**
+     * Has the size of the vertex <u> been set by set_node_size()?
+     */
+    bool has_node_size(vertex_t u) const { return u < m_node_sizes.size() && m_node_sizes[u] != vec2{ 0, 0 }; }
+
+    /**
+     * Get the width and height of the vertex <u>.
+     */
+    vec2 node_dimensions(vertex_t u) const { 
+        return has_node_size(u) ? m_node_sizes[u] : vec2{ 2*node_size, 2*node_size };
+    }
+
+    /**
+     * Get the shape of the vertex <u>.
+     */
+    node_shape shape(vertex_t u) const { return has_node_size(u) ? m_node_shapes[u] : node_shape::ellipse; }
+
     /**
      * Get the number of vertices in the graph.
      * 
@@ -85,6 +189,9 @@ public:
     void remove_edge(vertex_t from, vertex_t to) {
         remove_neighour(m_out_neighbours[from], to);
         remove_neighour(m_in_neighbours[to], from);
+        if (from == to) {
+            set_loop(from, false);
+        }
     }
 
     friend std::ostream& operator<<(std::ostream& out, const graph& g) {
@@ -106,6 +213,35 @@ private:
     std::vector< std::vector<vertex_t> > m_out_neighbours;
     std::vector< std::vector<vertex_t> > m_in_neighbours;
 
+    // explicit sizes and shapes of the vertices, {0, 0} if the size was not set
+    std::vector< vec2 > m_node_sizes;
+    std::vector< node_shape > m_node_shapes;
+
+    // is there a loop at the vertex, only as long as the largest vertex with a loop
+    std::vector< bool > m_loops;
+
+    void set_loop(vertex_t u, bool value) {
+        if (m_loops.size() <= u) {
+            if (!value) return;
+            m_loops.resize(u + 1, false);
+        }
+        m_loops[u] = value;
+    }
+
+    // removes the repeated vertices from the list of neighbours of <owner>, <seen> holds the last owner in whose list each vertex was found
+    static bool remove_duplicates(std::vector<vertex_t>& neighbours, std::vector<vertex_t>& seen, vertex_t owner) {
+        auto out = neighbours.begin();
+        for (auto v : neighbours) {
+            if (seen[v] != owner) {
+                seen[v] = owner;
+                *out++ = v;
+            }
+        }
+        bool removed = out != neighbours.end();
+        neighbours.erase(out, neighbours.end());
+        return removed;
+    }
+
     void remove_neighour(std::vector<vertex_t>& neighbours, vertex_t u) {
         auto it = std::find(neighbours.begin(), neighbours.end(), u);
         if (it != neighbours.end()) {
@@ -124,39 +260,75 @@ private:
  * implicitely when creating edges.
  * 
  * If the vertices are not in the range `0 ... n-1`, where `n`
- * is the number of vertices, they will be mapped to this range.
+ * is the number of vertices, they will be mapped to this range
+ * in the order of their identifiers. Duplicate edges are added only once.
+ *
+ * The edges are only appended to an array, the duplicates are removed
+ * and the identifiers are remapped all at once in build(), which then
+ * creates the graph by graph::from_edge_list().
  */
 struct graph_builder {
-    std::set<vertex_t> nodes;
-    std::set<std::pair<vertex_t, vertex_t>> edges;
+    std::vector< std::pair<vertex_t, vertex_t> > edges;
 
     /**
      * Add a new edge.
      */
     graph_builder& add_edge(vertex_t u, vertex_t v) {
-        nodes.insert(u);
-        nodes.insert(v);
-        edges.emplace(u, v);
+        edges.emplace_back(u, v);
         return *this;
     }
 
     /**
-     * Get the resulting graph.
+     * Add all the edges in the range [<first>, <last>) of pairs of vertices.
      */
-    graph build() { 
-        graph g;
+    template<typename It>
+    graph_builder& add_edges(It first, It last) {
+        edges.insert(edges.end(), first, last);
+        return *this;
+    }
 
-        std::map<vertex_t, vertex_t> to_id;
+    graph_builder& add_edges(const std::vector< std::pair<vertex_t, vertex_t> >& list) {
+        return add_edges(list.begin(), list.end());
+    }
 
-        for (auto u : nodes) {
-            to_id[u] = g.add_node();
-        }
+    /**
+     * Get the resulting graph.
+     */
+    graph build() {
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
 
+        std::vector<vertex_t> nodes;
+        nodes.reserve(2*edges.size());
         for (auto [ u, v ] : edges) {
-            g.add_edge( to_id[u], to_id[v] );
+            nodes.push_back(u);
+            nodes.push_back(v);
+        }
+        std::sort(nodes.begin(), nodes.end());
+        nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+
+        std::vector< std::pair<vertex_t, vertex_t> > list;
+        list.reserve(edges.size());
+
+        // the identifiers are mapped through a table if they are dense enough, otherwise by a binary search
+        if (!nodes.empty() && nodes.back() < 4*nodes.size()) {
+            std::vector<vertex_t> to_id(nodes.back() + 1);
+            for (vertex_t i = 0; i < nodes.size(); ++i) {
+                to_id[nodes[i]] = i;
+            }
+            for (auto [ u, v ] : edges) {
+                list.emplace_back(to_id[u], to_id[v]);
+            }
+        } else {
+            auto to_id = [&nodes] (vertex_t u) {
+                return vertex_t(std::lower_bound(nodes.begin(), nodes.end(), u) - nodes.begin());
+            };
+            for (auto [ u, v ] : edges) {
+                list.emplace_back(to_id(u), to_id(v));
+            }
         }
 
-        return g; 
+        return graph::from_edge_list(list, nodes.size());
     }
 };
 
@@ -0,0 +1,319 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include <drag/graph.hpp>
+#include <drag/layout.hpp>
+#include <drag/types.hpp>
+
+namespace drag {
+
+/**
+ * Layout of a graph which changes over time by small modifications.
+ *
+ * Each connected component is laid out separately, so after a modification only
+ * the components containing the modified vertices are laid out again. These are
+ * warm started from their previous layout, so the vertices stay roughly in place.
+ * The other components are reused as they are and only shifted horizontally.
+ *
+ * The layout is updated lazily - the first access after a modification recomputes it.
+ */
+class incremental_layout {
+    struct component {
+        std::vector<vertex_t> vertices;  // identifiers of the vertices, sorted unless the component is dirty
+        std::vector<node> nodes;         // positions relative to the left edge of the component
+        path_list paths;
+        vec2 size = { 0, 0 };
+        bool dirty = true;     // has to be laid out again
+        bool split = false;    // might have fallen apart into several components
+    };
+
+    graph g;
+    attributes attrs;
+
+    std::vector<component> components;
+    std::vector<unsigned> component_of;
+
+    // the layers and order of each vertex in the last layout of its component
+    std::vector<int> ranks;
+    std::vector<float> order;
+    std::vector<bool> placed;  // false for the vertices which were not laid out yet
+
+    // the assembled layout
+    std::vector<node> nodes;
+    path_list paths;
+    vec2 size = { 0, 0 };
+    bool up_to_date = true;
+
+public:
+    incremental_layout() : incremental_layout(graph{}) {}
+
+    incremental_layout(graph source)
+        : incremental_layout(source, attributes{source.node_size, source.node_dist, source.layer_dist, source.loop_angle, source.loop_size, source.routing, source.concentrate}) {}
+
+    incremental_layout(const graph& source, attributes attr) : attrs(attr) {
+        for (auto u : source.vertices()) {
+            add_node();
+            if (source.has_node_size(u)) {
+                auto dim = source.node_dimensions(u);
+                set_node_size(u, dim.x, dim.y, source.shape(u));
+            }
+        }
+        for (auto u : source.vertices()) {
+            for (auto v : source.out_neighbours(u)) {
+                add_edge(u, v);
+            }
+        }
+    }
+
+    /**
+     * Add a new vertex to the graph.
+     *
+     * @return the identifier of the vertex
+     */
+    vertex_t add_node() {
+        vertex_t u = g.add_node();
+        component_of.push_back(components.size());
+        components.emplace_back();
+        components.back().vertices.push_back(u);
+        ranks.push_back(0);
+        order.push_back(0);
+        placed.push_back(false);
+        up_to_date = false;
+        return u;
+    }
+
+    /**
+     * Add a new edge to the graph.
+     * The behaviour is undefined if the same edge is added twice.
+     */
+    void add_edge(vertex_t from, vertex_t to) {
+        g.add_edge(from, to);
+        merge(component_of[from], component_of[to]);
+        components[ component_of[from] ].dirty = true;
+        up_to_date = false;
+    }
+
+    /**
+     * Remove the given edge from the graph.
+     */
+    void remove_edge(vertex_t from, vertex_t to) {
+        g.remove_edge(from, to);
+        auto& c = components[ component_of[from] ];
+        c.dirty = true;
+        c.split = true;
+        up_to_date = false;
+    }
+
+    /**
+     * Set the width and height of the vertex <u> and its shape.
+     */
+    void set_node_size(vertex_t u, float width, float height, node_shape shape = node_shape::rectangle) {
+        g.set_node_size(u, width, height, shape);
+        components[ component_of[u] ].dirty = true;
+        up_to_date = false;
+    }
+
+    const graph& get_graph() const { return g; }
+    const attributes& attribs() const { return attrs; }
+
+    /**
+     * Returns the positions and sizes of all the vertices in the graph.
+     */
+    const std::vector<node>& vertices() { update(); return nodes; }
+
+    /**
+     * Returns the control points for all the edges in the graph.
+     */
+    const path_list& edges() { update(); return paths; }
+
+    float width() { update(); return size.x; }
+    float height() { update(); return size.y; }
+    vec2 dimensions() { update(); return size; }
+
+    /**
+     * Lays out all modified components and assembles the final layout.
+     * Called automatically when the layout is accessed.
+     */
+    void update() {
+        if (up_to_date)
+            return;
+
+        split_components();
+
+        std::vector<vertex_t> local_id(g.size());
+        for (auto& c : components) {
+            if (c.dirty) {
+                std::sort(c.vertices.begin(), c.vertices.end());
+                layout_component(c, local_id);
+            }
+        }
+
+        assemble();
+        up_to_date = true;
+    }
+
+private:
+    /**
+     * Merges the components <i> and <j>, the vertices of <j> are kept to the right of the vertices of <i>.
+     * The smaller component is moved into the larger one, so building a component by adding edges one by one
+     * moves each vertex at most log n times. The vertices are sorted again once the component is laid out.
+     */
+    void merge(unsigned i, unsigned j) {
+        if (i == j)
+            return;
+
+        float offset = components[i].size.x + attrs.node_dist;
+        if (components[i].vertices.size() < components[j].vertices.size()) {
+            std::swap(i, j);
+            // the absorbed component is now the left one
+            offset = -(components[j].size.x + attrs.node_dist);
+        }
+
+        for (auto u : components[j].vertices) {
+            order[u] += offset;
+            component_of[u] = i;
+        }
+
+        auto& target = components[i].vertices;
+        auto& source = components[j].vertices;
+        target.insert(target.end(), source.begin(), source.end());
+        components[i].size.x += attrs.node_dist + components[j].size.x;
+        components[i].split = components[i].split || components[j].split;
+
+        remove_component(j);
+    }
+
+    void remove_component(unsigned i) {
+        if (i != components.size() - 1) {
+            components[i] = std::move(components.back());
+            for (auto u : components[i].vertices) {
+                component_of[u] = i;
+            }
+        }
+        components.pop_back();
+    }
+
+    // splits all components which might have been disconnected by removing an edge
+    void split_components() {
+        std::vector<bool> done(g.size(), false);
+        std::vector<vertex_t> stack;
+
+        for (unsigned i = 0; i < components.size(); ++i) {
+            if (!components[i].split)
+                continue;
+            components[i].split = false;
+
+            std::vector<vertex_t> vertices = std::move(components[i].vertices);
+            components[i].vertices.clear();
+
+            bool first = true;
+            for (auto s : vertices) {
+                if (done[s])
+                    continue;
+
+                unsigned idx = i;
+                if (!first) {
+                    idx = components.size();
+                    components.emplace_back();
+                }
+                first = false;
+
+                auto& part = components[idx].vertices;
+                done[s] = true;
+                stack.push_back(s);
+                while (!stack.empty()) {
+                    vertex_t u = stack.back();
+                    stack.pop_back();
+                    part.push_back(u);
+                    component_of[u] = idx;
+                    for (auto v : chain_range< std::vector<vertex_t> >(g.out_neighbours(u), g.in_neighbours(u))) {
+                        if (!done[v]) {
+                            done[v] = true;
+                            stack.push_back(v);
+                        }
+                    }
+                }
+                std::sort(part.begin(), part.end());
+                components[idx].dirty = true;
+            }
+        }
+    }
+
+    void layout_component(component& c, std::vector<vertex_t>& local_id) {
+        // the vertices without a previous layout get the last identifiers, so they are outside of the hint
+        std::vector<vertex_t> vertices = c.vertices;
+        auto unplaced = std::stable_partition(vertices.begin(), vertices.end(), [this] (vertex_t u) { return placed[u]; });
+
+        graph local;
+        layout_hint hint;
+        for (auto u : vertices) {
+            local_id[u] = local.add_node();
+            if (g.has_node_size(u)) {
+                auto dim = g.node_dimensions(u);
+                local.set_node_size(local_id[u], dim.x, dim.y, g.shape(u));
+            }
+        }
+        for (auto it = vertices.begin(); it != unplaced; ++it) {
+            hint.ranks.push_back(ranks[*it]);
+            hint.order.push_back(order[*it]);
+        }
+        for (auto u : vertices) {
+            for (auto v : g.out_neighbours(u)) {
+                local.add_edge(local_id[u], local_id[v]);
+            }
+        }
+
+        sugiyama_layout layout(local, attrs, hint);
+
+        c.nodes = layout.vertices();
+        for (auto& n : c.nodes) {
+            n.u = vertices[n.u];
+        }
+        c.paths = layout.edges();
+        c.paths.relabel(vertices);
+        c.size = layout.dimensions();
+        c.dirty = false;
+
+        auto new_hint = layout.hint();
+        for (vertex_t i = 0; i < vertices.size(); ++i) {
+            ranks[ vertices[i] ] = new_hint.ranks[i];
+            order[ vertices[i] ] = new_hint.order[i];
+            placed[ vertices[i] ] = true;
+        }
+    }
+
+    // places the components next to each other in the order of their smallest vertices
+    void assemble() {
+        std::vector<unsigned> sorted(components.size());
+        for (unsigned i = 0; i < components.size(); ++i) {
+            sorted[i] = i;
+        }
+        std::sort(sorted.begin(), sorted.end(), [this] (unsigned i, unsigned j) {
+            return components[i].vertices.front() < components[j].vertices.front();
+        });
+
+        // the paths are cleared to reuse the already allocated points
+        nodes.resize(g.size());
+        paths.clear();
+        size = { 0, 0 };
+
+        for (auto i : sorted) {
+            const auto& c = components[i];
+            for (auto n : c.nodes) {
+                n.pos.x += size.x;
+                nodes[n.u] = n;
+            }
+            paths.append(c.paths, { size.x, 0 });
+            size.x += c.size.x + attrs.node_dist;
+            size.y = std::max(size.y, c.size.y);
+        }
+
+        if (!components.empty()) {
+            size.x -= attrs.node_dist;
+        }
+    }
+};
+
+} // namespace drag
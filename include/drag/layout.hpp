@@ -5,6 +5,7 @@
 
 #include <vector>
 #include <memory>
+#include <optional>
 
 #include <drag/detail/subgraph.hpp>
 
@@ -13,12 +14,9 @@
 #include <drag/detail/positioning.hpp>
 #include <drag/detail/crossing.hpp>
 #include <drag/detail/router.hpp>
+#include <drag/detail/shape.hpp>
 #include <drag/detail/algo.hpp>
 
-#ifdef CONTROL_CROSSING
-bool crossing_enabled = true;
-#endif
-
 namespace drag {
 
 class sugiyama_layout {
@@ -29,12 +27,17 @@ class sugiyama_layout {
 
     // the final positions of vertices and control points of edges
     std::vector< node > nodes;
-    std::vector< path > paths;
+    path_list paths;
     vec2 size = { 0, 0 };
 
+    // the layer of each original vertex
+    std::vector< int > ranks;
+
     // attributes controling spacing
     attributes attrs;
 
+    layout_stats stats;
+
     // algorithms for individual steps of sugiyama framework
     std::unique_ptr< detail::cycle_removal > cycle_module =     
                         std::make_unique< detail::dfs_removal >();
@@ -50,12 +53,20 @@ class sugiyama_layout {
     
     std::unique_ptr< detail::edge_router > routing_module = 
                         std::make_unique< detail::router >(nodes, paths, attrs);
+    edge_routing routing_kind = edge_routing::polyline;  // the kind of the current routing_module
+
+    bool hinted = false;  // are the layering and crossing modules started from a layout_hint?
+
+    std::optional<layout_debug> debugging;  // set only for layouts created for debugging
+
+    std::optional<layout_control> control;  // set only for layouts which can be cancelled or report progress
+    unsigned long finished_work = 0;         // the sum of the vertex counts of the components over their finished stages
 
 public:
     sugiyama_layout(graph g) 
         : g(g)
         , original_vertex_count(g.size())
-        , attrs( attributes{g.node_size, g.node_dist, g.layer_dist, g.loop_angle, g.loop_size} ) {
+        , attrs( attributes{g.node_size, g.node_dist, g.layer_dist, g.loop_angle, g.loop_size, g.routing, g.concentrate} ) {
         build();
     }
 
@@ -67,8 +78,117 @@ public:
         build();
     }
 
+    /**
+     * Lays out the graph starting from a previous layout described by <hint>.
+     * The vertices keep their previous layers and order unless it is necessary to change them.
+     */
+    sugiyama_layout(graph g, const layout_hint& hint)
+        : sugiyama_layout(g, attributes{g.node_size, g.node_dist, g.layer_dist, g.loop_angle, g.loop_size, g.routing, g.concentrate}, hint) {}
+
+    sugiyama_layout(graph g, attributes attr, const layout_hint& hint) 
+        : g(g)
+        , original_vertex_count(g.size())
+        , attrs(attr) 
+    {
+        layering_module = std::make_unique< detail::network_simplex_layering >(hint.ranks);
+        crossing_module = std::make_unique< detail::barycentric_heuristic >(hint.order, hint.stability);
+        hinted = true;
+        build();
+    }
+
+    /**
+     * Replaces this layout by a layout of the graph <g>.
+     * The result is the same as of sugiyama_layout(g), but the modules and the memory of this layout
+     * are reused. Laying out many small graphs one after another this way avoids most of the allocations.
+     */
+    void relayout(const graph& g) {
+        this->g = g;
+        original_vertex_count = g.size();
+
+        attributes attr { g.node_size, g.node_dist, g.layer_dist, g.loop_angle, g.loop_size, g.routing, g.concentrate };
+        if (attr != attrs) {
+            attrs = attr;
+            // the positioning keeps its own copy of the attributes
+            positioning_module = make_positioning();
+        }
+        if (hinted) {
+            layering_module = std::make_unique< detail::network_simplex_layering >();
+            crossing_module = std::make_unique< detail::barycentric_heuristic >();
+            hinted = false;
+        }
+
+        nodes.clear();
+        paths.clear();
+        boxes.clear();
+        ranks.clear();
+        size = { 0, 0 };
+        stats = layout_stats{};
+        if (debugging) {
+            debugging->labels.clear();
+        }
+        build();
+    }
+
+    /**
+     * Lays out the graph with the debugging switches <debug>.
+     * The information recorded during the layout can be read from debug().
+     */
+    sugiyama_layout(graph g, layout_debug debug)
+        : g(g)
+        , original_vertex_count(g.size())
+        , attrs( attributes{g.node_size, g.node_dist, g.layer_dist, g.loop_angle, g.loop_size, g.routing, g.concentrate} )
+        , debugging(std::move(debug))
+    {
+        debugging->labels.clear();
+        auto layering = std::make_unique< detail::network_simplex_layering >();
+        if (debugging->simplex_labels) {
+            layering->record_labels(&debugging->labels);
+        }
+        layering_module = std::move(layering);
+        positioning_module = make_positioning();
+        build();
+    }
+
+    /**
+     * Lays out the graph, reporting the progress and checking for cancellation through <control>.
+     * If control.token is cancelled, the constructor throws layout_cancelled.
+     */
+    sugiyama_layout(graph g, layout_control control)
+        : g(g)
+        , original_vertex_count(g.size())
+        , attrs( attributes{g.node_size, g.node_dist, g.layer_dist, g.loop_angle, g.loop_size, g.routing, g.concentrate} )
+        , control(std::move(control))
+    {
+        build();
+    }
+
+    // the modules keep references to the members of the layout, so it can be neither copied nor moved
+    sugiyama_layout(const sugiyama_layout&) = delete;
+    sugiyama_layout(sugiyama_layout&&) = delete;
+    sugiyama_layout& operator=(const sugiyama_layout&) = delete;
+    sugiyama_layout& operator=(sugiyama_layout&&) = delete;
+
     const attributes& attribs() const { return attrs; }
 
+    /**
+     * Returns the debugging switches and the recorded information, nullptr if the layout was not created for debugging.
+     */
+    const layout_debug* debug() const { return debugging ? &*debugging : nullptr; }
+
+    /**
+     * Returns the layers and order of the vertices in this layout.
+     * It can be used to lay out a modified graph while keeping the vertices in place.
+     */
+    layout_hint hint() const {
+        layout_hint h;
+        h.ranks = ranks;
+        h.order.resize(original_vertex_count);
+        for (vertex_t u = 0; u < original_vertex_count; ++u) {
+            h.order[u] = nodes[u].pos.x;
+        }
+        return h;
+    }
+
     /**
      * Returns the positions and sizes of all the vertices in the graph.
      * Calling this function before build was called is undefined.
@@ -77,56 +197,292 @@ public:
 
     /**
      * Returns the control points for all the edges in the graph.
+     * The points of all the edges are stored in one array, use path_list::to_vector to get independent paths.
      * Calling this function before build was called is undefined.
      */
-    const std::vector<path>& edges() const { return paths; }
+    const path_list& edges() const { return paths; }
 
     float width() const { return size.x; }
     float height() const { return size.y; }
     vec2 dimensions() const { return size; } 
 
+    /**
+     * Returns the time spent in the individual stages of the layout and the counters describing them.
+     */
+    const layout_stats& statistics() const { return stats; }
+
 private:
+    std::unique_ptr< detail::positioning > make_positioning() {
+        auto positioning = std::make_unique< detail::fast_and_simple_positioning >(attrs, nodes, boxes, g);
+        if (debugging) {
+            positioning->use_alignment(debugging->alignment);
+        }
+        return positioning;
+    }
+
     void build() {
+        if (attrs.routing != routing_kind) {
+            routing_kind = attrs.routing;
+            if (attrs.routing == edge_routing::orthogonal) {
+                routing_module = std::make_unique< detail::orthogonal_router >(nodes, paths, attrs);
+            } else if (attrs.routing == edge_routing::spline) {
+                routing_module = std::make_unique< detail::spline_router >(nodes, paths, attrs);
+            } else {
+                routing_module = std::make_unique< detail::router >(nodes, paths, attrs);
+            }
+        }
+
+        finished_work = 0;
+        if (control) {
+            control->token.throw_if_cancelled();
+            layering_module->cancellation = &control->token;
+            crossing_module->cancellation = &control->token;
+        }
+
+        if (control && control->preview) {
+            draft_preview();
+        }
+
+        stopwatch clock;
         std::vector< detail::subgraph > subgraphs = detail::split(g);
+        stats.split += clock.lap();
+        stats.components = subgraphs.size();
         init_nodes();
-
-        vec2 start { 0, 0 };
-        for (auto& g : subgraphs) {
-            vec2 dim = process_subgraph(g, start);
-            start.x += dim.x + attrs.node_dist;
-            size.x += dim.x + attrs.node_dist;
-            size.y = std::max(size.y, dim.y);
+        ranks.resize(original_vertex_count, 0);
+
+        if (control && control->preview) {
+            build_progressive(subgraphs);
+        } else {
+            for (auto& g : subgraphs) {
+                component c = rank_component(g);
+                order_component(c);
+                place_next(c);
+            }
         }
 
         size.x -= attrs.node_dist;
         nodes.resize(original_vertex_count);
     }
 
-    vec2 process_subgraph(detail::subgraph& g, vec2 start) {
+    /**
+     * Runs each stage for all the components before the next one, so that previews of the whole graph can be made between them.
+     * The maps of a hierarchy are as large as the largest vertex identifier of its component, so only the layers
+     * and the reversed edges of each component are kept between the stages and the hierarchies are restored from them.
+     */
+    void build_progressive(std::vector< detail::subgraph >& subgraphs) {
+        std::vector< saved_component > saved;
+        saved.reserve(subgraphs.size());
+        for (auto& g : subgraphs) {
+            saved.push_back(save(g, rank_component(g)));
+        }
+        preview(subgraphs, saved, preview_stage::ranked);
+
+        for (size_t i = 0; i < subgraphs.size(); ++i) {
+            component c = restore(subgraphs[i], saved[i]);
+            order_component(c);
+            saved[i].layers = std::move(c.h.layers);
+        }
+        preview(subgraphs, saved, preview_stage::ordered);
+
+        for (size_t i = 0; i < subgraphs.size(); ++i) {
+            component c = restore(subgraphs[i], saved[i]);
+            place_next(c);
+        }
+    }
+
+    // a connected component during the layout
+    struct component {
+        detail::rev_edges reversed_edges;
+        detail::hierarchy h;
+        unsigned vertex_count;  // without the dummy vertices
+    };
+
+    // a component between the stages of a progressive layout, kept without any maps indexed by the vertices
+    struct saved_component {
+        std::vector< detail::edge > reversed;
+        std::vector< detail::edge > collapsed;
+        std::vector< vertex_t > loops;
+        std::vector< std::vector<vertex_t> > layers;
+        unsigned vertex_count;
+    };
+
+    saved_component save(const detail::subgraph& g, component c) {
+        auto edges = [&g] (const detail::edge_set& set) {
+            std::vector< detail::edge > list;
+            for (auto u : g.vertices()) {
+                if (set.data.contains(u)) {
+                    for (auto v : set.data[u]) {
+                        list.push_back({ u, v });
+                    }
+                }
+            }
+            return list;
+        };
+        return saved_component{ edges(c.reversed_edges.reversed), edges(c.reversed_edges.collapsed),
+                                std::move(c.reversed_edges.loops), std::move(c.h.layers), c.vertex_count };
+    }
+
+    component restore(detail::subgraph& g, const saved_component& saved) {
+        detail::rev_edges reversed_edges;
+        for (auto e : saved.reversed) {
+            reversed_edges.reversed.insert(e);
+        }
+        for (auto e : saved.collapsed) {
+            reversed_edges.collapsed.insert(e);
+        }
+        reversed_edges.loops = saved.loops;
+
+        detail::hierarchy h(g, -1);
+        h.pos.resize(g);
+        h.layers = saved.layers;
+        for (int i = 0; i < h.size(); ++i) {
+            for (auto u : h.layers[i]) {
+                h.ranking[u] = i;
+            }
+        }
+        h.update_pos();
+        return component{ std::move(reversed_edges), std::move(h), saved.vertex_count };
+    }
+
+    // removes the cycles, assigns the vertices to layers and adds the dummy vertices
+    component rank_component(detail::subgraph& g) {
+        stopwatch clock;
+        unsigned vertex_count = g.size();
 
         auto reversed_edges = cycle_module->run(g);
+        stats.cycle_removal += clock.lap();
+        report(layout_stage::cycle_removal, vertex_count, clock);
+
         detail::hierarchy h = layering_module->run(g);
+        for (auto u : g.vertices()) {
+            ranks[u] = h.ranking[u];
+        }
+        layering_module->add_stats(stats);
+        stats.layering += clock.lap();
+        report(layout_stage::layering, vertex_count, clock);
 
+        if (attrs.concentrate) {
+            detail::concentrate_edges(h, reversed_edges);
+        }
         auto long_edges = add_dummy_nodes(h);
         update_reversed_edges(reversed_edges, long_edges);
         update_dummy_nodes();
-        
-#ifdef CONTROL_CROSSING
-        if (crossing_enabled) {
-            crossing->run(h);    
+        stats.dummy_vertices += g.size() - vertex_count;
+        stats.dummy_insertion += clock.lap();
+        report(layout_stage::dummy_insertion, vertex_count, clock);
+
+        return component{ std::move(reversed_edges), std::move(h), vertex_count };
+    }
+
+    void order_component(component& c) {
+        stopwatch clock;
+        if (!debugging || debugging->crossing_reduction) {
+            crossing_module->run(c.h);
+            crossing_module->add_stats(stats);
         }
-#else
-        crossing_module->run(h);
-#endif
-        enlarge_loop_boxes(reversed_edges);
+        enlarge_loop_boxes(c.reversed_edges);
+        stats.crossing_reduction += clock.lap();
+        report(layout_stage::crossing_reduction, c.vertex_count, clock);
+    }
 
-        vec2 dimensions = positioning_module->run(h, start);
+    vec2 place_component(component& c, vec2 start) {
+        stopwatch clock;
+        vec2 dimensions = positioning_module->run(c.h, start);
+        stats.positioning += clock.lap();
+        report(layout_stage::positioning, c.vertex_count, clock);
 
-        routing_module->run(h, reversed_edges);
+        routing_module->run(c.h, c.reversed_edges);
+        stats.routing += clock.lap();
+        report(layout_stage::routing, c.vertex_count, clock);
 
         return dimensions;
     }
 
+    // positions and routes the component to the right of the components placed before it
+    void place_next(component& c) {
+        vec2 dim = place_component(c, { size.x, 0 });
+        size.x += dim.x + attrs.node_dist;
+        size.y = std::max(size.y, dim.y);
+    }
+
+    // creates the layout with the quick modules used for preview_stage::draft
+    struct draft_tag {};
+
+    sugiyama_layout(const graph& g, attributes attr, draft_tag)
+        : g(g)
+        , original_vertex_count(g.size())
+        , attrs(attr)
+    {
+        auto layering = std::make_unique< detail::network_simplex_layering >();
+        layering->set_optimize(false);
+        layering_module = std::move(layering);
+        crossing_module = std::make_unique< detail::barycentric_heuristic >(1, 0, false);
+        positioning_module = std::make_unique< detail::simple_positioning >(attrs, nodes, boxes);
+        build();
+    }
+
+    void draft_preview() {
+        stopwatch clock;
+        sugiyama_layout draft(g, attrs, draft_tag{});
+        layout_preview result { preview_stage::draft, std::move(draft.nodes), std::move(draft.paths), draft.size };
+        stats.previews += clock.lap();
+
+        control->preview(result);
+        control->token.throw_if_cancelled();
+    }
+
+    /**
+     * Positions and routes copies of the hierarchies of the components by the quick modules
+     * and passes the result to the preview callback.
+     */
+    void preview(std::vector< detail::subgraph >& subgraphs, const std::vector< saved_component >& saved, preview_stage stage) {
+        stopwatch clock;
+        detail::barycentric_heuristic sweep(1, 0, false);
+        detail::simple_positioning positioning(attrs, nodes, boxes);
+
+        vec2 start { 0, 0 };
+        vec2 dimensions { 0, 0 };
+        for (size_t i = 0; i < subgraphs.size(); ++i) {
+            component c = restore(subgraphs[i], saved[i]);
+            if (stage == preview_stage::ranked) {
+                sweep.run(c.h);
+            }
+            vec2 dim = positioning.run(c.h, start);
+            routing_module->run(c.h, c.reversed_edges);
+
+            start.x += dim.x + attrs.node_dist;
+            dimensions.x += dim.x + attrs.node_dist;
+            dimensions.y = std::max(dimensions.y, dim.y);
+        }
+        dimensions.x = std::max(0.0f, dimensions.x - attrs.node_dist);
+
+        layout_preview result { stage, { nodes.begin(), nodes.begin() + original_vertex_count }, std::move(paths), dimensions };
+        stats.previews += clock.lap();
+
+        control->preview(result);
+        // the paths of the finished layout are routed into the same list again
+        paths = std::move(result.paths);
+        paths.clear();
+        control->token.throw_if_cancelled();
+    }
+
+    /**
+     * Reports that the <stage> of the component with <vertex_count> vertices is finished and checks for cancellation.
+     * All the stages are assumed to take the same time per vertex. The time spent in the callback is not counted in the statistics.
+     */
+    void report(layout_stage stage, unsigned vertex_count, stopwatch& clock) {
+        if (!control) {
+            return;
+        }
+        control->token.throw_if_cancelled();
+        finished_work += vertex_count;
+        if (control->progress) {
+            const float stage_count = 6;
+            control->progress(stage, std::min(1.0f, finished_work / (stage_count * original_vertex_count)));
+            clock.lap();
+        }
+    }
+
     void update_dummy_nodes() {
         boxes.resize(g, { {0, 0}, { 0, 0} });
         
@@ -135,6 +491,7 @@ private:
         for (; i < nodes.size(); ++i) {
             nodes[i].u = i;
             nodes[i].size = 0;
+            nodes[i].half_size = { 0, 0 };
         }
     }
 
@@ -149,9 +506,15 @@ private:
         boxes.resize( g );
         for ( auto u : g.vertices() ) {
             nodes[u].u = u;
-            nodes[u].size = attrs.node_size;
-            boxes[u] = { { 2*nodes[u].size, 2*nodes[u].size },
-                         { nodes[u].size, nodes[u].size } };
+            if (g.has_node_size(u)) {
+                nodes[u].half_size = 0.5f*g.node_dimensions(u);
+                nodes[u].shape = g.shape(u);
+            } else {
+                nodes[u].half_size = { attrs.node_size, attrs.node_size };
+                nodes[u].shape = node_shape::ellipse;
+            }
+            nodes[u].size = detail::enclosing_radius(nodes[u].half_size, nodes[u].shape);
+            boxes[u] = { 2*nodes[u].half_size, nodes[u].half_size };
         }
     }
 
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+
+#include <drag/types.hpp>
+#include <drag/layout.hpp>
+#include <drag/detail/metrics.hpp>
+
+namespace drag {
+
+/**
+ * Measures of the quality of a finished layout.
+ *
+ * Curved edges are approximated by poly-lines for the crossings, lengths and overlaps.
+ * The crossings and overlaps are found by a sweep and a uniform grid, so for the layered layouts
+ * computing all the measures takes time close to linear in the number of nodes, edge segments and crossings.
+ */
+struct metrics {
+    int crossings = 0;       /**< the number of pairs of crossing segments of different edges */
+    int bends = 0;           /**< the number of points where an edge changes its direction */
+    float edge_length = 0;   /**< the total length of all edges */
+    float area = 0;          /**< the area of the bounding box of the layout */
+    float aspect_ratio = 0;  /**< the width of the layout divided by its height */
+    int node_overlaps = 0;   /**< the number of pairs of an edge and a node other than its endpoints which the edge goes through */
+
+    metrics() = default;
+
+    metrics(const sugiyama_layout& l) : metrics(l.vertices(), l.edges(), l.dimensions()) {}
+
+    /**
+     * Measures the layout given by its nodes and paths, which are either a path_list or a vector of paths.
+     */
+    template<typename Paths>
+    metrics(const std::vector<node>& nodes, const Paths& paths, vec2 dimensions) {
+        crossings = detail::segment_sweep(detail::make_segments(paths)).run();
+
+        for (const auto& p : paths) {
+            bends += detail::count_bends(p);
+            auto points = detail::flatten(p);
+            for (size_t i = 1; i < points.size(); ++i) {
+                edge_length += distance(points[i - 1], points[i]);
+            }
+        }
+
+        area = dimensions.x * dimensions.y;
+        aspect_ratio = dimensions.y == 0 ? 0 : dimensions.x / dimensions.y;
+
+        // the edges touching the border of a node don't overlap it
+        node_overlaps = detail::count_node_overlaps(nodes, paths, 0.5f);
+    }
+};
+
+} // namespace drag
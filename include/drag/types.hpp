@@ -1,8 +1,17 @@
 #pragma once
 
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <map>
 #include <vector>
 #include <limits>
+#include <chrono>
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
 
 #include <drag/vec2.hpp>
 
@@ -10,13 +19,23 @@ namespace drag {
 
 using vertex_t = unsigned;
 
+/**
+ * The shape of a node.
+ */
+enum class node_shape {
+    ellipse,    /**< an ellipse, or a circle if the width and height are the same */
+    rectangle,  /**< an axis aligned rectangle */
+};
+
 /**
  * Object representing a vertex in the final layout.
  */
 struct node {
     vertex_t u;  /**< the corresponding vertex identifier */
     vec2 pos;    /**< the position in space */
-    float size;  /**< the radius */
+    float size = 0;  /**< the radius, for other shapes than circles the radius of the smallest circle containing the node */
+    vec2 half_size = { size, size };         /**< half of the width and height */
+    node_shape shape = node_shape::ellipse;  /**< the shape of the node */
 };
 
 /**
@@ -26,17 +45,324 @@ struct path {
     vertex_t from, to;          /**< the vertex identifiers of endpoints of the corresponding edge */
     std::vector< vec2 > points; /**< control points of the poly-line representing the edge */
     bool bidirectional = false; /**< is the edge bidirectional? */
+    bool curved = false;        /**< are the points control points of a cubic Bézier spline [p0, c1, c2, p1, c1, c2, p2, ...]? */
+};
+
+/**
+ * Contiguous range of control points stored in a shared array.
+ */
+class point_range {
+    const vec2* m_first = nullptr;
+    const vec2* m_last = nullptr;
+
+public:
+    point_range() = default;
+    point_range(const vec2* first, const vec2* last) : m_first(first), m_last(last) {}
+    point_range(const std::vector<vec2>& points) : m_first(points.data()), m_last(points.data() + points.size()) {}
+
+    const vec2* begin() const { return m_first; }
+    const vec2* end() const { return m_last; }
+    const vec2* data() const { return m_first; }
+    size_t size() const { return m_last - m_first; }
+    bool empty() const { return m_first == m_last; }
+    const vec2& operator[](size_t i) const { return m_first[i]; }
+    const vec2& front() const { return *m_first; }
+    const vec2& back() const { return *(m_last - 1); }
+};
+
+inline bool operator==(point_range lhs, point_range rhs) {
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+}
+
+inline bool operator!=(point_range lhs, point_range rhs) { return !(lhs == rhs); }
+
+/**
+ * Path whose control points are stored in a path_list.
+ * It is only valid until the list is modified.
+ */
+struct path_ref {
+    vertex_t from, to;
+    point_range points;
+    bool bidirectional;
+    bool curved;
+
+    /**
+     * Copies the path including its points.
+     */
+    path to_path() const { return path{ from, to, { points.begin(), points.end() }, bidirectional, curved }; }
+};
+
+/**
+ * Paths of all the edges of a layout with the control points of all of them in one contiguous array.
+ * Each path refers to its range of the points, so the whole list takes only a couple of allocations.
+ */
+class path_list {
+    struct entry {
+        vertex_t from, to;
+        unsigned first;  // the index of the first point in m_points
+        unsigned count;
+        bool bidirectional;
+        bool curved;
+    };
+
+    std::vector<entry> m_entries;
+    std::vector<vec2> m_points;
+
+public:
+    /**
+     * Iterator over the paths. The dereferenced path is kept inside of the iterator,
+     * so loops binding it by reference work the same as with a vector of paths.
+     */
+    class iterator {
+        const path_list* m_list;
+        size_t m_i;
+        mutable path_ref m_current {};
+
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = path_ref;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const path_ref*;
+        using reference = const path_ref&;
+
+        iterator(const path_list* list, size_t i) : m_list(list), m_i(i) {}
+
+        const path_ref& operator*() const { m_current = (*m_list)[m_i]; return m_current; }
+        const path_ref* operator->() const { return &**this; }
+        iterator& operator++() { ++m_i; return *this; }
+        iterator operator++(int) { auto copy = *this; ++m_i; return copy; }
+        bool operator==(const iterator& other) const { return m_i == other.m_i; }
+        bool operator!=(const iterator& other) const { return m_i != other.m_i; }
+    };
+
+    size_t size() const { return m_entries.size(); }
+    bool empty() const { return m_entries.empty(); }
+
+    path_ref operator[](size_t i) const {
+        const auto& e = m_entries[i];
+        const vec2* first = m_points.data() + e.first;
+        return path_ref{ e.from, e.to, { first, first + e.count }, e.bidirectional, e.curved };
+    }
+
+    iterator begin() const { return iterator(this, 0); }
+    iterator end() const { return iterator(this, size()); }
+
+    /**
+     * Returns the control points of all the paths, in the order of the paths.
+     */
+    const std::vector<vec2>& points() const { return m_points; }
+
+    void reserve(size_t paths, size_t points) {
+        m_entries.reserve(paths);
+        m_points.reserve(points);
+    }
+
+    /**
+     * Removes all the paths but keeps the allocated memory.
+     */
+    void clear() {
+        m_entries.clear();
+        m_points.clear();
+    }
+
+    void push_back(const path& p) {
+        m_entries.push_back(entry{ p.from, p.to, unsigned(m_points.size()), unsigned(p.points.size()), p.bidirectional, p.curved });
+        m_points.insert(m_points.end(), p.points.begin(), p.points.end());
+    }
+
+    /**
+     * Appends all the paths of <other> with their points moved by <offset>.
+     */
+    void append(const path_list& other, vec2 offset) {
+        auto base = unsigned(m_points.size());
+        for (auto e : other.m_entries) {
+            e.first += base;
+            m_entries.push_back(e);
+        }
+        for (auto p : other.m_points) {
+            m_points.push_back(p + offset);
+        }
+    }
+
+    /**
+     * Replaces the endpoints u of all the paths by <ids>[u].
+     */
+    void relabel(const std::vector<vertex_t>& ids) {
+        for (auto& e : m_entries) {
+            e.from = ids[e.from];
+            e.to = ids[e.to];
+        }
+    }
+
+    /**
+     * Copies the paths into independent path objects, as they were returned by the layouts before.
+     */
+    std::vector<path> to_vector() const {
+        std::vector<path> paths;
+        paths.reserve(size());
+        for (auto p : *this) {
+            paths.push_back(p.to_path());
+        }
+        return paths;
+    }
+};
+
+/**
+ * The way the edges are routed between the nodes.
+ */
+enum class edge_routing {
+    polyline,    /**< poly-lines going through the positions of the dummy vertices */
+    orthogonal,  /**< lines consisting only of horizontal and vertical segments */
+    spline,      /**< smooth curves approximating the poly-lines by cubic Bézier splines */
 };
 
 /**
  * Contains the parameters of the desired graph layout.
  */
 struct attributes {
-    float node_size = 25;        /**< radius of all nodes */
+    float node_size = 25;        /**< radius of the nodes without an explicit size */
     float node_dist = 20;        /**< minimum distance between borders of 2 nodes */
     float layer_dist = 40;       /**< minimum distance between borders of nodes in 2 different layers */
     float loop_angle = 55;       /**< angle determining the point on the node where a loop connects to it */
     float loop_size = node_size; /**< distance which the loop extends from the node*/
+    edge_routing routing = edge_routing::polyline; /**< how the edges are routed */
+    bool concentrate = false;    /**< merge long edges with a common endpoint until they diverge */
+};
+
+inline bool operator==(const attributes& lhs, const attributes& rhs) {
+    return lhs.node_size == rhs.node_size && lhs.node_dist == rhs.node_dist && lhs.layer_dist == rhs.layer_dist &&
+           lhs.loop_angle == rhs.loop_angle && lhs.loop_size == rhs.loop_size &&
+           lhs.routing == rhs.routing && lhs.concentrate == rhs.concentrate;
+}
+inline bool operator!=(const attributes& lhs, const attributes& rhs) { return !(lhs == rhs); }
+
+/**
+ * Ranks and in-layer order of the vertices of a previous layout.
+ * Used to warm start the layout of a similar graph, so the vertices stay roughly in place.
+ * Vertices with identifiers outside of the vectors are treated as new.
+ */
+struct layout_hint {
+    std::vector<int> ranks;    /**< the layer of each vertex */
+    std::vector<float> order;  /**< the order of vertices within their layer, smaller values are further to the left */
+    float stability = 1;       /**< how strongly the vertices are held in their previous order */
+};
+
+/**
+ * Time spent in the individual stages of a layout and counters describing the work done in them.
+ * The stages run separately for each connected component, their times and counters are summed over the components.
+ */
+struct layout_stats {
+    using duration = std::chrono::nanoseconds;
+
+    duration split { 0 };               /**< splitting the graph into connected components */
+    duration cycle_removal { 0 };
+    duration layering { 0 };
+    duration dummy_insertion { 0 };     /**< concentrating edges and splitting long edges by dummy vertices */
+    duration crossing_reduction { 0 };
+    duration positioning { 0 };
+    duration routing { 0 };
+    duration previews { 0 };            /**< computing the previews requested by layout_control::preview */
+
+    int components = 0;          /**< the number of connected components */
+    int simplex_iterations = 0;  /**< pivots of the network simplex layering */
+    int crossing_passes = 0;     /**< barycenter sweeps of the crossing reduction */
+    int initial_crossings = 0;   /**< crossings of the initial order of the layers */
+    int final_crossings = 0;     /**< crossings of the final order of the layers */
+    int dummy_vertices = 0;
+
+    duration total() const {
+        return split + cycle_removal + layering + dummy_insertion + crossing_reduction + positioning + routing + previews;
+    }
+};
+
+/**
+ * Switches for debugging the stages of a layout and the information recorded by them.
+ * It is owned by the layout it is given to, layouts created without it do no debugging work.
+ */
+struct layout_debug {
+    bool crossing_reduction = true;  /**< if false, the order of the vertices from the layering is kept */
+    int alignment = -1;              /**< if 0 to 3, the positioning uses only this one of its four alignments instead of their median */
+    bool simplex_labels = false;     /**< record the parent and the cut value of each vertex in the spanning tree of the network simplex */
+
+    std::map<vertex_t, std::string> labels;  /**< the labels recorded by the network simplex, "u(parent, cut value)" */
+};
+
+/**
+ * The stages of a layout, in the order in which they run for each connected component.
+ */
+enum class layout_stage {
+    cycle_removal,
+    layering,
+    dummy_insertion,
+    crossing_reduction,
+    positioning,
+    routing,
+};
+
+/**
+ * Thrown by a layout which was cancelled through its cancellation_token.
+ */
+struct layout_cancelled : std::runtime_error {
+    layout_cancelled() : std::runtime_error("The layout was cancelled") {}
+};
+
+/**
+ * Flag through which a running layout can be cancelled from another thread.
+ * All the copies of a token share the same flag.
+ */
+class cancellation_token {
+    std::shared_ptr< std::atomic<bool> > m_cancelled = std::make_shared< std::atomic<bool> >(false);
+
+public:
+    void cancel() { m_cancelled->store(true, std::memory_order_relaxed); }
+    bool cancelled() const { return m_cancelled->load(std::memory_order_relaxed); }
+
+    void throw_if_cancelled() const {
+        if (cancelled()) {
+            throw layout_cancelled();
+        }
+    }
+};
+
+/**
+ * The intermediate results of a layout, from the quickest to the most refined one.
+ */
+enum class preview_stage {
+    draft,    /**< longest path ranking, a single barycenter sweep and simple positioning */
+    ranked,   /**< optimal ranking by the network simplex, a single barycenter sweep and simple positioning */
+    ordered,  /**< the final order of the vertices after the full crossing reduction and simple positioning */
+};
+
+/**
+ * An intermediate result of a layout, which can be drawn until the layout is finished.
+ * The nodes and paths have the same meaning as the ones of the finished layout.
+ */
+struct layout_preview {
+    preview_stage stage;
+    std::vector<node> nodes;
+    path_list paths;
+    vec2 size;
+};
+
+/**
+ * Cancellation and progress reporting of a running layout.
+ */
+struct layout_control {
+    cancellation_token token;  /**< checked between the stages and during the long ones */
+
+    /**
+     * Called on the thread computing the layout after each stage of each component,
+     * with the fraction of the layout done so far - the vertices of the finished components
+     * and the part of the current one, assuming all stages take the same time.
+     */
+    std::function<void(layout_stage, float)> progress;
+
+    /**
+     * If set, the layout is progressive. It is called on the thread computing the layout with a quick draft
+     * before the layout starts and with more refined previews once the network simplex and the crossing
+     * reduction are finished. The final positioning is the finished layout itself.
+     */
+    std::function<void(const layout_preview&)> preview;
 };
 
 namespace detail {
@@ -0,0 +1,147 @@
+#include "catch.hpp"
+
+#include <drag/drag.hpp>
+#include <drag/async.hpp>
+#include <drag/detail/gen.hpp>
+
+#include <functional>
+#include <vector>
+
+using namespace drag;
+
+
+TEST_CASE("asynchronous layout") {
+    dag_generator gen(11);
+    graph g = gen.generate_components(3, 20, 40);
+
+    std::vector<layout_stage> stages;
+    std::vector<float> done;
+    layout_control control;
+    control.progress = [&] (layout_stage stage, float fraction) {
+        stages.push_back(stage);
+        done.push_back(fraction);
+    };
+
+    auto layout = layout_async(g, control).get();
+    sugiyama_layout expected(g);
+    REQUIRE( layout->dimensions() == expected.dimensions() );
+    REQUIRE( layout->edges().points() == expected.edges().points() );
+
+    // all six stages of the three components
+    REQUIRE( stages.size() == 18 );
+    REQUIRE( stages.front() == layout_stage::cycle_removal );
+    REQUIRE( stages.back() == layout_stage::routing );
+    REQUIRE( std::is_sorted(done.begin(), done.end()) );
+    REQUIRE( done.back() == Approx(1) );
+}
+
+TEST_CASE("cancelling a layout") {
+    dag_generator gen(12);
+    graph g = gen.generate_cyclic(60, 150);
+
+    SECTION("before it starts") {
+        layout_control control;
+        control.token.cancel();
+        auto result = layout_async(g, control);
+        REQUIRE_THROWS_AS( result.get(), layout_cancelled );
+    }
+
+    SECTION("between the stages") {
+        layout_control control;
+        int calls = 0;
+        control.progress = [&calls, token = control.token] (layout_stage stage, float) mutable {
+            ++calls;
+            if (stage == layout_stage::layering) {
+                token.cancel();
+            }
+        };
+        REQUIRE_THROWS_AS( sugiyama_layout(g, control), layout_cancelled );
+        REQUIRE( calls == 2 );
+    }
+
+    SECTION("during the network simplex and the crossing reduction") {
+        cancellation_token token;
+        token.cancel();
+
+        graph copy = g;
+        detail::subgraph s(copy);
+        detail::dfs_removal().run(s);
+
+        detail::network_simplex_layering layering;
+        layering.cancellation = &token;
+        REQUIRE_THROWS_AS( layering.run(s), layout_cancelled );
+
+        auto h = detail::network_simplex_layering().run(s);
+        detail::barycentric_heuristic crossing;
+        crossing.cancellation = &token;
+        REQUIRE_THROWS_AS( crossing.run(h), layout_cancelled );
+    }
+}
+
+TEST_CASE("layout on an executor") {
+    std::vector< std::function<void()> > queue;
+    auto executor = [&queue] (std::function<void()> task) { queue.push_back(std::move(task)); };
+
+    graph g;
+    g.add_node();
+    g.add_node();
+    g.add_edge(0, 1);
+
+    auto result = layout_async(executor, g);
+    REQUIRE( queue.size() == 1 );
+    REQUIRE( result.wait_for(std::chrono::seconds(0)) == std::future_status::timeout );
+
+    queue.front()();
+    REQUIRE( result.get()->vertices().size() == 2 );
+}
+
+static void check_progressive(const graph& g) {
+    std::vector<layout_preview> previews;
+    layout_control control;
+    control.preview = [&previews] (const layout_preview& p) { previews.push_back(p); };
+
+    sugiyama_layout layout(g, control);
+    sugiyama_layout expected(g);
+
+    // the previews do not change the finished layout
+    REQUIRE( layout.dimensions() == expected.dimensions() );
+    for (auto u : g.vertices()) {
+        REQUIRE( layout.vertices()[u].pos == expected.vertices()[u].pos );
+    }
+    REQUIRE( layout.edges().points() == expected.edges().points() );
+
+    REQUIRE( previews.size() == 3 );
+    REQUIRE( previews[0].stage == preview_stage::draft );
+    REQUIRE( previews[1].stage == preview_stage::ranked );
+    REQUIRE( previews[2].stage == preview_stage::ordered );
+    for (const auto& p : previews) {
+        REQUIRE( p.nodes.size() == g.size() );
+        REQUIRE( p.paths.size() == layout.edges().size() );
+        for (const auto& n : p.nodes) {
+            REQUIRE( n.pos.x - n.half_size.x >= -0.01f );
+            REQUIRE( n.pos.x + n.half_size.x <= p.size.x + 0.01f );
+            REQUIRE( n.pos.y + n.half_size.y <= p.size.y + 0.01f );
+        }
+    }
+
+    // the ranked and ordered previews have the layers of the finished layout
+    for (auto u : g.vertices()) {
+        REQUIRE( previews[2].nodes[u].pos.y == layout.vertices()[u].pos.y );
+    }
+
+    control.preview = [token = control.token] (const layout_preview&) mutable { token.cancel(); };
+    REQUIRE_THROWS_AS( sugiyama_layout(g, control), layout_cancelled );
+}
+
+TEST_CASE("progressive layout") {
+    dag_generator gen(13);
+    graph g = gen.generate_components(2, 30, 60);
+    g.add_edge(4, 4);
+    g.set_node_size(0, 80, 30);
+    check_progressive(g);
+
+    // the reversed edges are kept between the stages too
+    graph cyclic = gen.generate_cyclic(40, 90);
+    cyclic.add_edge(2, 2);
+    check_progressive(cyclic);
+}
@@ -0,0 +1,113 @@
+#include "catch.hpp"
+
+#include <drag/drag.hpp>
+#include <drag/batch.hpp>
+#include <drag/detail/gen.hpp>
+
+#include <atomic>
+#include <stdexcept>
+#include <type_traits>
+
+using namespace drag;
+
+
+// graphs of different sizes, shapes and routings
+static std::vector<graph> small_graphs(size_t count) {
+    dag_generator gen(7);
+    std::vector<graph> graphs;
+    for (size_t i = 0; i < count; ++i) {
+        size_t n = 5 + i % 30;
+        graph g = i % 4 == 0 ? gen.generate_cyclic(n, 2*n) : gen.generate_components(2, n / 2 + 1, n);
+        g.routing = i % 3 == 0 ? edge_routing::polyline : i % 3 == 1 ? edge_routing::orthogonal : edge_routing::spline;
+        g.node_dist = 10 + i % 2 * 5;
+        g.add_edge(1, 1);
+        if (i % 5 == 0) {
+            g.set_node_size(0, 60, 20);
+        }
+        graphs.push_back(std::move(g));
+    }
+    return graphs;
+}
+
+template<typename Layout>
+static void require_same(const Layout& lhs, const sugiyama_layout& rhs) {
+    REQUIRE( lhs.dimensions() == rhs.dimensions() );
+    REQUIRE( lhs.vertices().size() == rhs.vertices().size() );
+    for (size_t u = 0; u < rhs.vertices().size(); ++u) {
+        REQUIRE( lhs.vertices()[u].pos == rhs.vertices()[u].pos );
+        REQUIRE( lhs.vertices()[u].half_size == rhs.vertices()[u].half_size );
+    }
+    REQUIRE( lhs.edges().size() == rhs.edges().size() );
+    for (size_t j = 0; j < rhs.edges().size(); ++j) {
+        REQUIRE( lhs.edges()[j].from == rhs.edges()[j].from );
+        REQUIRE( lhs.edges()[j].points == rhs.edges()[j].points );
+    }
+}
+
+// the modules of a layout refer to its members
+static_assert( !std::is_copy_constructible_v<sugiyama_layout> && !std::is_move_constructible_v<sugiyama_layout> );
+static_assert( !std::is_copy_assignable_v<sugiyama_layout> && !std::is_move_assignable_v<sugiyama_layout> );
+
+TEST_CASE("relayout gives the same layout as a new one") {
+    auto graphs = small_graphs(40);
+
+    sugiyama_layout reused(graphs[0], sugiyama_layout(graphs[0]).hint());
+    for (const auto& g : graphs) {
+        reused.relayout(g);
+        require_same(reused, sugiyama_layout(g));
+    }
+}
+
+static void require_same(const batch_layout& batch, const std::vector<graph>& graphs) {
+    REQUIRE( batch.size() == graphs.size() );
+
+    for (size_t i = 0; i < graphs.size(); ++i) {
+        sugiyama_layout layout(graphs[i]);
+        REQUIRE( batch.dimensions(i) == layout.dimensions() );
+        REQUIRE( batch.vertex_count(i) == layout.vertices().size() );
+        REQUIRE( batch.edge_count(i) == layout.edges().size() );
+
+        for (vertex_t u = 0; u < batch.vertex_count(i); ++u) {
+            REQUIRE( batch.vertex(i, u).u == u );
+            REQUIRE( batch.vertex(i, u).pos == layout.vertices()[u].pos );
+        }
+        for (size_t j = 0; j < batch.edge_count(i); ++j) {
+            REQUIRE( batch.edge(i, j).to == layout.edges()[j].to );
+            REQUIRE( batch.edge(i, j).points == layout.edges()[j].points );
+        }
+    }
+}
+
+TEST_CASE("batch layout") {
+    auto graphs = small_graphs(100);
+
+    for (unsigned threads : { 1, 3 }) {
+        require_same(batch_layout(graphs, threads), graphs);
+    }
+
+    REQUIRE( batch_layout(std::vector<graph>{}).size() == 0 );
+}
+
+TEST_CASE("batches laid out by one pool") {
+    auto graphs = small_graphs(120);
+    layout_pool pool(3);
+    REQUIRE( pool.size() == 3 );
+
+    // the threads and their layouts carry over from one batch to the next
+    for (size_t first : { 0, 50, 100 }) {
+        std::vector<graph> part(graphs.begin() + first, graphs.begin() + std::min<size_t>(first + 50, graphs.size()));
+        require_same(batch_layout(pool, part), part);
+    }
+    REQUIRE( batch_layout(pool, std::vector<graph>{}).size() == 0 );
+
+    // an exception thrown on one thread is rethrown by run, and the pool can still be used
+    std::atomic<unsigned> calls { 0 };
+    REQUIRE_THROWS_AS( pool.run([&calls] (unsigned id) {
+        ++calls;
+        if (id == 2) {
+            throw std::runtime_error("failed");
+        }
+    }), std::runtime_error );
+    REQUIRE( calls == 3 );
+    require_same(batch_layout(pool, graphs), graphs);
+}
@@ -0,0 +1,117 @@
+#include "catch.hpp"
+
+#include <drag/drag.hpp>
+#include <drag/binary_layout.hpp>
+#include <drag/detail/gen.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+using namespace drag;
+
+
+static void require_same(const layout_view& view, const sugiyama_layout& layout) {
+    const auto& nodes = layout.vertices();
+    const auto& paths = layout.edges();
+
+    REQUIRE( view.node_count() == nodes.size() );
+    REQUIRE( view.path_count() == paths.size() );
+    REQUIRE( view.width() == layout.width() );
+    REQUIRE( view.height() == layout.height() );
+
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        node n = view.vertex(i);
+        REQUIRE( n.u == nodes[i].u );
+        REQUIRE( n.pos == nodes[i].pos );
+        REQUIRE( n.size == nodes[i].size );
+        REQUIRE( n.half_size == nodes[i].half_size );
+        REQUIRE( n.shape == nodes[i].shape );
+    }
+
+    for (size_t i = 0; i < paths.size(); ++i) {
+        path p = view.edge(i);
+        REQUIRE( p.from == paths[i].from );
+        REQUIRE( p.to == paths[i].to );
+        REQUIRE( p.points == paths[i].points );
+        REQUIRE( p.bidirectional == paths[i].bidirectional );
+        REQUIRE( p.curved == paths[i].curved );
+    }
+}
+
+static std::vector<std::uint32_t> to_words(const std::string& bytes) {
+    std::vector<std::uint32_t> words(bytes.size() / 4);
+    std::memcpy(words.data(), bytes.data(), bytes.size());
+    return words;
+}
+
+
+TEST_CASE("binary layout round trip") {
+    dag_generator gen(42);
+
+    for (auto routing : { edge_routing::polyline, edge_routing::spline }) {
+        graph g = gen.generate_from_edges(30, 60);
+        g.routing = routing;
+        g.set_node_size(0, 40, 20, node_shape::rectangle);
+        g.add_edge(3, 3);
+        sugiyama_layout layout(g);
+
+        std::ostringstream out;
+        write_layout(out, layout);
+        auto words = to_words(out.str());
+
+        layout_view view(words.data(), out.str().size());
+        require_same(view, layout);
+    }
+}
+
+TEST_CASE("binary layout rejects invalid data") {
+    graph g;
+    g.add_node();
+    g.add_node();
+    g.add_edge(0, 1);
+    sugiyama_layout layout(g);
+
+    std::ostringstream out;
+    write_layout(out, layout);
+    auto words = to_words(out.str());
+    size_t size = out.str().size();
+
+    REQUIRE_NOTHROW( layout_view(words.data(), size) );
+    REQUIRE_THROWS_AS( layout_view(words.data(), 16), std::invalid_argument );
+    REQUIRE_THROWS_AS( layout_view(words.data(), size - 8), std::invalid_argument );
+
+    auto wrong_magic = words;
+    wrong_magic[0] = 0;
+    REQUIRE_THROWS_AS( layout_view(wrong_magic.data(), size), std::invalid_argument );
+
+    auto swapped = words;
+    swapped[2] = 0x04030201;
+    REQUIRE_THROWS_AS( layout_view(swapped.data(), size), std::invalid_argument );
+
+    // the first point of the only path is past the end of the points
+    auto corrupted = words;
+    corrupted[(sizeof(binary::header) + 2*sizeof(binary::node_record))/4 + 3] = 100;
+    layout_view view(corrupted.data(), size);
+    REQUIRE_THROWS_AS( view.points(0), std::out_of_range );
+}
+
+TEST_CASE("mapped binary layout") {
+    dag_generator gen(7);
+    graph g = gen.generate_from_edges(20, 35);
+    sugiyama_layout layout(g);
+
+    const char* filename = "test-layout.bin";
+    {
+        std::ofstream out(filename, std::ios::binary);
+        write_layout(out, layout);
+    }
+    {
+        mapped_layout file(filename);
+        require_same(file.view(), layout);
+    }
+    std::remove(filename);
+
+    REQUIRE_THROWS_AS( mapped_layout("no-such-layout.bin"), std::invalid_argument );
+}
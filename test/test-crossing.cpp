@@ -0,0 +1,125 @@
+#include "catch.hpp"
+#include "utils/test-utils.hpp"
+
+#include <drag/detail/crossing.hpp>
+#include <drag/detail/gen.hpp>
+
+#include <cmath>
+#include <random>
+
+using namespace drag;
+using namespace drag::detail;
+
+
+// a generated acyclic graph split into layers, with the long edges replaced by paths of dummy vertices
+struct proper_hierarchy {
+    graph source;
+    subgraph g;
+    hierarchy h;
+
+    proper_hierarchy(graph acyclic)
+        : source(std::move(acyclic))
+        , g(make_subgraph(source))
+        , h(network_simplex_layering().run(g))
+    {
+        add_dummy_nodes(h);
+    }
+};
+
+TEST_CASE("packed neighbour positions give the crossing number") {
+    dag_generator gen(21);
+    std::mt19937 mt(5);
+
+    for (int i = 0; i < 10; ++i) {
+        proper_hierarchy p(gen.generate_from_edges(30, 60));
+        hierarchy& h = p.h;
+
+        neighbour_positions neighbours;
+        neighbours.build(h);
+
+        // swap random neighbouring vertices the same way as transpose does
+        for (int k = 0; k < 100; ++k) {
+            auto& layer = h.layers[mt() % h.size()];
+            if (layer.size() < 2) {
+                continue;
+            }
+            int j = mt() % (layer.size() - 1);
+            h.swap(layer[j], layer[j + 1]);
+            neighbours.swap(h, layer[j], layer[j + 1]);
+
+            if (k % 10 != 0) {
+                continue;
+            }
+            for (const auto& l : h.layers) {
+                for (auto u : l) {
+                    for (auto v : l) {
+                        if (u != v) {
+                            REQUIRE( neighbours.crossing_number(h, u, v) == crossing_number(h, u, v) );
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("radix sort of the barycenters") {
+    std::mt19937 mt(3);
+    std::uniform_real_distribution<float> any(-100, 100);
+    const std::vector<float> special = { 0.0f, -0.0f, 1.0f, -1.0f, 0.5f, -1e-30f, 1e30f, -1e30f };
+
+    for (size_t n : { 64, 65, 100, 257, 1000 }) {
+        std::vector<float> weights(n);
+        for (auto& w : weights) {
+            // many equal keys, so that the stability matters
+            switch (mt() % 3) {
+            case 0: w = any(mt); break;
+            case 1: w = special[mt() % special.size()]; break;
+            case 2: w = std::round(any(mt)) / 4; break;
+            }
+        }
+
+        std::vector<sort_entry> keys, tmp;
+        std::vector<vertex_t> expected;
+        for (vertex_t u = 0; u < n; ++u) {
+            keys.push_back({ sort_key(weights[u]), u });
+            expected.push_back(u);
+        }
+        std::stable_sort(expected.begin(), expected.end(), [&weights] (vertex_t u, vertex_t v) {
+            return weights[u] < weights[v];
+        });
+
+        radix_sort(keys, tmp);
+        REQUIRE( keys.size() == n );
+        for (size_t i = 0; i < n; ++i) {
+            REQUIRE( keys[i].second == expected[i] );
+        }
+    }
+}
+
+TEST_CASE("skipping unchanged layers gives the same order") {
+    dag_generator gen(22);
+
+    for (int i = 0; i < 20; ++i) {
+        graph g = gen.generate_from_edges(20 + 3*i, 30 + 8*i);
+        proper_hierarchy full(g);
+        proper_hierarchy skipped(g);
+
+        // several random restarts, so that the layers are also invalidated by shuffling
+        barycentric_heuristic full_module(3, 7, true);
+        barycentric_heuristic skipped_module(3, 7, true);
+        full_module.set_skip_unchanged(false);
+        full_module.run(full.h);
+        skipped_module.run(skipped.h);
+
+        REQUIRE( full.h.layers == skipped.h.layers );
+
+        layout_stats full_stats, skipped_stats;
+        full_module.add_stats(full_stats);
+        skipped_module.add_stats(skipped_stats);
+        REQUIRE( full_stats.initial_crossings == skipped_stats.initial_crossings );
+        REQUIRE( full_stats.final_crossings == skipped_stats.final_crossings );
+        REQUIRE( full_stats.crossing_passes == skipped_stats.crossing_passes );
+        REQUIRE( skipped_stats.final_crossings == count_crossings(skipped.h) );
+    }
+}
@@ -107,3 +107,17 @@ TEST_CASE("two cycles without shared edge") {
 
     REQUIRE( check_acyclic(g) );
 }
+
+TEST_CASE("loops are removed") {
+    graph source = graph::from_edge_list({ { 0, 1 }, { 1, 1 }, { 1, 2 }, { 2, 0 }, { 2, 2 } });
+    subgraph g = make_subgraph(source);
+
+    std::unique_ptr<cycle_removal> c = std::make_unique<dfs_removal>();
+    auto rev = c->run(g);
+
+    REQUIRE( rev.loops == std::vector<vertex_t>{ 1, 2 } );
+    REQUIRE( !source.has_loop(1) );
+    REQUIRE( !source.has_loop(2) );
+    REQUIRE( check_acyclic(g) );
+    REQUIRE( check_edge_count(g, 3) );
+}
@@ -0,0 +1,104 @@
+#include "catch.hpp"
+
+#include <drag/dot.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+using namespace drag;
+
+
+static bool has_edge(const graph& g, vertex_t u, vertex_t v) {
+    const auto& out = g.out_neighbours(u);
+    return std::find(out.begin(), out.end(), v) != out.end();
+}
+
+TEST_CASE("parsing a dot graph") {
+    auto dot = parse_dot(R"(
+        strict digraph "test graph" {
+            // graph attributes
+            ranksep = 30; nodesep=15
+            splines=ortho
+            fontsize = 12.5
+            graph [concentrate=true]
+            node [shape=circle]
+
+            a -> b -> c;  # a chain
+            a -> "long name" [color=red]
+            /* a node with
+               attributes */
+            b [width=80, height=30, shape=box];
+            d
+            c->d
+        }
+    )");
+    const auto& g = dot.g;
+
+    REQUIRE( g.size() == 5 );
+    REQUIRE( dot.names == std::vector<std::string>{ "a", "b", "c", "long name", "d" } );
+    REQUIRE( has_edge(g, 0, 1) );
+    REQUIRE( has_edge(g, 1, 2) );
+    REQUIRE( has_edge(g, 0, 3) );
+    REQUIRE( has_edge(g, 2, 4) );
+    REQUIRE( g.in_neighbours(4).size() == 1 );
+
+    REQUIRE( g.layer_dist == 30 );
+    REQUIRE( g.node_dist == 15 );
+    REQUIRE( g.routing == edge_routing::orthogonal );
+    REQUIRE( g.concentrate );
+    REQUIRE( dot.font_size == 12.5f );
+
+    REQUIRE( g.node_dimensions(1) == vec2{ 80, 30 } );
+    REQUIRE( g.shape(1) == node_shape::rectangle );
+    REQUIRE( !g.has_node_size(0) );
+}
+
+TEST_CASE("parsing statements without the graph header") {
+    auto dot = parse_dot("x -> y\ny -> z\nz -> x\n");
+    REQUIRE( dot.g.size() == 3 );
+    REQUIRE( has_edge(dot.g, 2, 0) );
+}
+
+TEST_CASE("repeated edges in a dot graph") {
+    auto dot = parse_dot("digraph { ranksep=10; a -> b; a -> b -> a; b -> b; b -> b }");
+    REQUIRE( dot.g.out_neighbours(0) == std::vector<vertex_t>{ 1 } );
+    REQUIRE( dot.g.out_neighbours(1) == std::vector<vertex_t>{ 0, 1 } );
+    REQUIRE( dot.g.has_loop(1) );
+    REQUIRE( dot.g.layer_dist == 10 );
+}
+
+TEST_CASE("invalid dot input") {
+    REQUIRE_THROWS_AS( parse_dot("digraph { a -> }"), std::invalid_argument );
+    REQUIRE_THROWS_AS( parse_dot("digraph { a -> b"), std::invalid_argument );
+    REQUIRE_THROWS_AS( parse_dot("digraph { subgraph s { a } }"), std::invalid_argument );
+    REQUIRE_THROWS_AS( parse_dot("digraph { a:n -> b }"), std::invalid_argument );
+    REQUIRE_THROWS_AS( parse_dot("digraph { \"a -> b }"), std::invalid_argument );
+    REQUIRE_THROWS_AS( parse_dot("digraph { a [width=wide] }"), std::invalid_argument );
+    REQUIRE_THROWS_WITH( parse_dot("digraph {\n a [width=-3] }"), Catch::Contains("line 2") );
+    REQUIRE_THROWS_AS( parse_dot("digraph { a [height=inf] }"), std::invalid_argument );
+    REQUIRE_THROWS_WITH( parse_dot("digraph {\n a -> b\n c -> @\n}"), Catch::Contains("line 3") );
+}
+
+TEST_CASE("reading a dot file") {
+    const char* filename = "test-graph.gv";
+    {
+        std::ofstream out(filename);
+        out << "digraph {\n";
+        for (int i = 0; i < 1000; ++i) {
+            out << "  n" << i << " -> n" << (i + 1) << ";\n";
+        }
+        out << "}\n";
+    }
+
+    auto dot = read_dot(filename);
+    std::remove(filename);
+
+    REQUIRE( dot.g.size() == 1001 );
+    REQUIRE( dot.names[1000] == "n1000" );
+    for (vertex_t u = 0; u < 1000; ++u) {
+        REQUIRE( has_edge(dot.g, u, u + 1) );
+    }
+
+    REQUIRE_THROWS_AS( read_dot("no-such-graph.gv"), std::invalid_argument );
+}
@@ -117,3 +117,45 @@ TEST_CASE("graph builder") {
     assert_neighbours_equal(g.in_neighbours(1), {0});
     assert_neighbours_equal(g.in_neighbours(2), {1});
 }
+
+TEST_CASE("graph builder with sparse identifiers and duplicate edges") {
+    std::vector< std::pair<vertex_t, vertex_t> > list = { { 1000000, 7 }, { 7, 42 }, { 1000000, 7 }, { 42, 42 } };
+    graph g = graph_builder()
+                .add_edges(list)
+                .add_edge(7, 42)
+                .build();
+
+    REQUIRE(g.size() == 3);
+    // the vertices are numbered in the order of their identifiers: 7, 42, 1000000
+    assert_neighbours_equal(g.out_neighbours(0), {1});
+    assert_neighbours_equal(g.out_neighbours(1), {1});
+    assert_neighbours_equal(g.out_neighbours(2), {0});
+
+    assert_neighbours_equal(g.in_neighbours(0), {2});
+    assert_neighbours_equal(g.in_neighbours(1), {0, 1});
+    assert_neighbours_equal(g.in_neighbours(2), {});
+}
+
+TEST_CASE("graph from an edge list") {
+    std::vector< std::pair<vertex_t, vertex_t> > list = { { 2, 0 }, { 0, 1 }, { 2, 1 }, { 0, 1 }, { 1, 1 }, { 2, 0 }, { 1, 1 } };
+    graph g = graph::from_edge_list(list, 5);
+
+    REQUIRE(g.size() == 5);
+    // the neighbours are in the order of the first occurrences of the edges
+    REQUIRE( g.out_neighbours(0) == std::vector<vertex_t>{ 1 } );
+    REQUIRE( g.out_neighbours(1) == std::vector<vertex_t>{ 1 } );
+    REQUIRE( g.out_neighbours(2) == std::vector<vertex_t>{ 0, 1 } );
+    REQUIRE( g.in_neighbours(0) == std::vector<vertex_t>{ 2 } );
+    REQUIRE( g.in_neighbours(1) == std::vector<vertex_t>{ 0, 2, 1 } );
+    assert_neighbours_equal(g.out_neighbours(4), {});
+
+    REQUIRE( g.has_loop(1) );
+    REQUIRE( !g.has_loop(0) );
+    REQUIRE( !g.has_loop(4) );
+    g.remove_edge(1, 1);
+    REQUIRE( !g.has_loop(1) );
+    g.add_edge(0, 0);
+    REQUIRE( g.has_loop(0) );
+
+    REQUIRE( graph::from_edge_list(list).size() == 3 );
+}
@@ -0,0 +1,120 @@
+#include "catch.hpp"
+
+#include <drag/incremental.hpp>
+
+#include <algorithm>
+
+using namespace drag;
+
+
+static bool has_path(const path_list& paths, vertex_t from, vertex_t to) {
+    return std::any_of(paths.begin(), paths.end(), [=] (path_ref p) {
+        return p.from == from && p.to == to;
+    });
+}
+
+static void check_layout(incremental_layout& layout) {
+    const auto& g = layout.get_graph();
+    REQUIRE( layout.vertices().size() == g.size() );
+
+    int edge_count = 0;
+    for (auto u : g.vertices()) {
+        REQUIRE( layout.vertices()[u].u == u );
+        for (auto v : g.out_neighbours(u)) {
+            REQUIRE( has_path(layout.edges(), u, v) );
+            ++edge_count;
+        }
+    }
+    REQUIRE( layout.edges().size() == edge_count );
+}
+
+TEST_CASE("incremental layout of a growing graph") {
+    incremental_layout layout;
+
+    auto a = layout.add_node();
+    auto b = layout.add_node();
+    auto c = layout.add_node();
+    layout.add_edge(a, b);
+    check_layout(layout);
+
+    // c is a separate component
+    REQUIRE( layout.vertices()[c].pos.x > layout.vertices()[a].pos.x );
+
+    layout.add_edge(b, c);
+    check_layout(layout);
+    REQUIRE( layout.vertices()[c].pos.y > layout.vertices()[b].pos.y );
+}
+
+TEST_CASE("incremental layout keeps unmodified components") {
+    graph g = graph_builder()
+                .add_edge(0, 1).add_edge(0, 2).add_edge(1, 3).add_edge(2, 3)
+                .add_edge(4, 5).add_edge(4, 6)
+                .build();
+    incremental_layout layout(g);
+    check_layout(layout);
+
+    auto before = layout.vertices();
+
+    layout.add_edge(5, 6);
+    check_layout(layout);
+
+    for (vertex_t u = 0; u < 4; ++u) {
+        REQUIRE( layout.vertices()[u].pos == before[u].pos );
+    }
+}
+
+TEST_CASE("incremental layout after removing an edge") {
+    graph g = graph_builder()
+                .add_edge(0, 1).add_edge(1, 2).add_edge(2, 3)
+                .build();
+    incremental_layout layout(g);
+    check_layout(layout);
+
+    layout.remove_edge(1, 2);
+    check_layout(layout);
+
+    // the graph fell apart into two components placed next to each other
+    REQUIRE( layout.vertices()[2].pos.x > layout.vertices()[1].pos.x );
+    REQUIRE( layout.vertices()[3].pos.x > layout.vertices()[1].pos.x );
+}
+
+TEST_CASE("incremental layout places new vertices by their neighbours") {
+    graph g = graph_builder()
+                .add_edge(0, 1).add_edge(0, 2)
+                .build();
+    incremental_layout layout(g);
+    check_layout(layout);
+    REQUIRE( layout.vertices()[1].pos.x < layout.vertices()[2].pos.x );
+
+    // the new vertex has no previous position, so it is not pinned to the left
+    auto u = layout.add_node();
+    layout.add_edge(u, 2);
+    check_layout(layout);
+
+    const auto& nodes = layout.vertices();
+    REQUIRE( nodes[u].pos.y == nodes[0].pos.y );
+    REQUIRE( nodes[u].pos.x > nodes[0].pos.x );
+    REQUIRE( nodes[1].pos.x < nodes[2].pos.x );
+}
+
+TEST_CASE("incremental layout of a long path") {
+    graph g;
+    for (int i = 0; i < 20000; ++i) {
+        g.add_node();
+    }
+    // every edge merges a single vertex into the growing component
+    for (vertex_t u = 1; u < g.size(); ++u) {
+        g.add_edge(u, u - 1);
+    }
+    incremental_layout layout(g);
+
+    // one component, with every vertex on its own layer
+    REQUIRE( layout.vertices().size() == 20000 );
+    REQUIRE( layout.edges().size() == 19999 );
+    std::vector<float> heights;
+    for (const auto& n : layout.vertices()) {
+        heights.push_back(n.pos.y);
+    }
+    std::sort(heights.begin(), heights.end());
+    REQUIRE( std::adjacent_find(heights.begin(), heights.end()) == heights.end() );
+}
@@ -130,6 +130,97 @@ TEST_CASE("Layering requiring network simplex.") {
     }
 }
 
+TEST_CASE("Layering seeded with a previous ranking.") {
+    graph source = graph_builder()
+                .add_edge(0, 1).add_edge(0, 5).add_edge(0, 6)
+                .add_edge(1, 2).add_edge(2, 3).add_edge(3, 4)
+                .add_edge(5, 7).add_edge(6, 7).add_edge(7, 4)
+                .build();
+
+    detail::subgraph g = make_subgraph(source);
+    auto previous = network_simplex_layering().run(g);
+
+    std::vector<int> ranks(source.size());
+    for (auto u : g.vertices()) {
+        ranks[u] = previous.ranking[u];
+    }
+
+    SECTION("same graph") {
+        network_simplex_layering layering_module(ranks);
+        auto h = layering_module.run(g);
+        check_hierarchy(h);
+        REQUIRE( get_total_edge_length(h) == 10 );
+        for (auto u : g.vertices()) {
+            REQUIRE( h.ranking[u] == previous.ranking[u] );
+        }
+    }
+
+    SECTION("added vertex") {
+        auto u = source.add_node();
+        source.add_edge(2, u);
+        detail::subgraph extended = make_subgraph(source);
+
+        network_simplex_layering layering_module(ranks);
+        auto h = layering_module.run(extended);
+        check_hierarchy(h);
+        REQUIRE( get_total_edge_length(h) == 11 );
+    }
+
+    SECTION("infeasible seed") {
+        std::reverse(ranks.begin(), ranks.end());
+        network_simplex_layering layering_module(ranks);
+        auto h = layering_module.run(g);
+        check_hierarchy(h);
+        REQUIRE( get_total_edge_length(h) == 10 );
+    }
+}
+
+// can <v> be reached from <u> going only through dummy vertices
+bool reachable_through_dummies(const subgraph& g, vertex_t u, vertex_t v) {
+    for (auto w : g.out_neighbours(u)) {
+        if (w == v || (g.is_dummy(w) && reachable_through_dummies(g, w, v))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+TEST_CASE("Concentrating long edges.") {
+    // 0 fans out to 3, 4 and 5, while 1 and 6 fan in to 5
+    graph source = graph_builder()
+                .add_edge(0, 1).add_edge(1, 2).add_edge(2, 3).add_edge(3, 4).add_edge(4, 5)
+                .add_edge(0, 3).add_edge(0, 4).add_edge(0, 5)
+                .add_edge(6, 1).add_edge(6, 5).add_edge(1, 5)
+                .build();
+    std::vector<edge> long_edges = { { 0, 3 }, { 0, 4 }, { 0, 5 }, { 6, 5 }, { 1, 5 } };
+
+    auto dummy_count = [&source, &long_edges] (bool concentrate) {
+        graph copy = source;
+        detail::subgraph g = make_subgraph(copy);
+        auto h = network_simplex_layering().run(g);
+        if (concentrate) {
+            concentrate_edges(h, rev_edges{});
+        }
+        add_dummy_nodes(h);
+        check_hierarchy(h);
+
+        for (auto u : g.vertices()) {
+            for (auto v : g.out_neighbours(u)) {
+                REQUIRE( h.span(u, v) == 1 );
+            }
+        }
+        for (auto e : long_edges) {
+            REQUIRE( reachable_through_dummies(g, e.from, e.to) );
+        }
+        return g.size() - source.size();
+    };
+
+    // 2 + 3 + 4 dummies for the fan-out and 4 + 3 for the fan-in
+    REQUIRE( dummy_count(false) == 16 );
+    // a single chain of 4 dummies for the fan-out and of 4 for the fan-in
+    REQUIRE( dummy_count(true) == 8 );
+}
+
 /*
 TEST_CASE("Layering stuff.") {
     graph source = graph_builder()
@@ -0,0 +1,147 @@
+#include "catch.hpp"
+
+#include <drag/drag.hpp>
+#include <drag/metrics.hpp>
+#include <drag/detail/gen.hpp>
+
+#include <cmath>
+
+using namespace drag;
+
+
+static path line(vertex_t from, vertex_t to, std::vector<vec2> points) {
+    return path{ from, to, std::move(points), false, false };
+}
+
+// tests every pair of segments
+static int brute_crossings(const std::vector<path>& paths) {
+    auto segs = detail::make_segments(paths);
+    double eps = 1e-4;
+    int count = 0;
+    for (size_t i = 0; i < segs.size(); ++i) {
+        for (size_t j = i + 1; j < segs.size(); ++j) {
+            const auto& s = segs[i];
+            const auto& t = segs[j];
+            if (s.path == t.path)
+                continue;
+            double rx = s.bx - s.ax, ry = s.by - s.ay;
+            double qx = t.bx - t.ax, qy = t.by - t.ay;
+            double denom = rx*qy - ry*qx;
+            if (std::abs(denom) <= 1e-9*std::hypot(rx, ry)*std::hypot(qx, qy))
+                continue;
+            double wx = t.ax - s.ax, wy = t.ay - s.ay;
+            double u = (wx*qy - wy*qx)/denom;
+            double v = (wx*ry - wy*rx)/denom;
+            double tu = eps/std::hypot(rx, ry), tv = eps/std::hypot(qx, qy);
+            if (u < -tu || u > 1 + tu || v < -tv || v > 1 + tv)
+                continue;
+            double x = s.ax + u*rx, y = s.ay + u*ry;
+            auto near = [x, y, eps] (double px, double py) { return std::abs(px - x) <= eps && std::abs(py - y) <= eps; };
+            if ((near(s.ax, s.ay) || near(s.bx, s.by)) && (near(t.ax, t.ay) || near(t.bx, t.by)))
+                continue;
+            ++count;
+        }
+    }
+    return count;
+}
+
+// tests every pair of a node and an edge
+static int brute_overlaps(const std::vector<node>& nodes, const std::vector<path>& paths) {
+    int count = 0;
+    for (const auto& p : paths) {
+        auto points = detail::flatten(p);
+        for (const auto& n : nodes) {
+            if (n.u == p.from || n.u == p.to)
+                continue;
+            for (size_t i = 1; i < points.size(); ++i) {
+                if (detail::segment_enters(n, points[i - 1], points[i], 0.5f)) {
+                    ++count;
+                    break;
+                }
+            }
+        }
+    }
+    return count;
+}
+
+
+TEST_CASE("metrics of a hand made layout") {
+    std::vector<node> nodes = {
+        node{ 0, { 0, 0 }, 5 },
+        node{ 1, { 100, 0 }, 5 },
+        node{ 2, { 0, 100 }, 5 },
+        node{ 3, { 100, 100 }, 5 },
+        node{ 4, { 50, 150 }, 5 },
+    };
+    std::vector<path> paths = {
+        line(0, 3, { { 0, 0 }, { 100, 100 } }),
+        line(1, 2, { { 100, 0 }, { 0, 100 } }),
+        line(0, 1, { { 0, 0 }, { 100, 0 } }),                            // shares endpoints with the others
+        line(2, 3, { { 0, 100 }, { 50, 100 }, { 50, 150 }, { 100, 100 } }),  // goes through the node 4
+    };
+
+    metrics m(nodes, paths, { 100, 150 });
+
+    REQUIRE( m.crossings == 1 );
+    REQUIRE( m.bends == 2 );
+    REQUIRE( m.edge_length == Approx(2*std::sqrt(2.0f)*100 + 100 + 100 + std::sqrt(2.0f)*50) );
+    REQUIRE( m.area == Approx(15000) );
+    REQUIRE( m.aspect_ratio == Approx(100.0f/150) );
+    REQUIRE( m.node_overlaps == 1 );
+}
+
+TEST_CASE("collinear points are not bends") {
+    REQUIRE( detail::count_bends(line(0, 1, { { 0, 0 }, { 0, 10 }, { 0, 20 } })) == 0 );
+    REQUIRE( detail::count_bends(line(0, 1, { { 0, 0 }, { 0, 10 }, { 0, 10 }, { 5, 20 } })) == 1 );
+
+    // smooth joints of a spline are not bends, sharp ones are
+    path curve{ 0, 1, { { 0, 0 }, { 0, 10 }, { 0, 20 }, { 10, 30 }, { 20, 40 }, { 30, 40 }, { 40, 40 } }, false, true };
+    REQUIRE( detail::count_bends(curve) == 0 );
+    curve.points[4] = { 20, 30 };
+    REQUIRE( detail::count_bends(curve) == 1 );
+}
+
+TEST_CASE("crossings and overlaps match brute force") {
+    dag_generator gen(61);
+
+    for (auto routing : { edge_routing::polyline, edge_routing::orthogonal, edge_routing::spline }) {
+        for (int i = 0; i < 10; ++i) {
+            graph g = gen.generate_from_edges(15 + 5*i, 30 + 10*i);
+            g.routing = routing;
+            g.concentrate = i % 2 == 1;
+            if (i % 3 == 0) {
+                for (auto u : g.vertices()) {
+                    g.set_node_size(u, 20 + 10*(u % 4), 15 + 10*(u % 3), u % 2 ? node_shape::ellipse : node_shape::rectangle);
+                }
+            }
+
+            sugiyama_layout layout(g);
+            metrics m(layout);
+
+            auto paths = layout.edges().to_vector();
+            REQUIRE( m.crossings == brute_crossings(paths) );
+            REQUIRE( m.node_overlaps == brute_overlaps(layout.vertices(), paths) );
+        }
+    }
+}
+
+TEST_CASE("layout statistics") {
+    graph g;
+    for (int i = 0; i < 7; ++i) {
+        g.add_node();
+    }
+    // a component with a long edge and a cycle, and a separate edge
+    g.add_edge(0, 1).add_edge(1, 2).add_edge(2, 3).add_edge(0, 3).add_edge(3, 1);
+    g.add_edge(4, 5);
+
+    sugiyama_layout layout(g);
+    const auto& stats = layout.statistics();
+
+    REQUIRE( stats.components == 3 );
+    REQUIRE( stats.dummy_vertices >= 2 );
+    REQUIRE( stats.final_crossings <= stats.initial_crossings );
+    REQUIRE( stats.crossing_passes >= stats.components );
+    REQUIRE( stats.total() > layout_stats::duration::zero() );
+    REQUIRE( stats.total() == stats.split + stats.cycle_removal + stats.layering + stats.dummy_insertion
+                            + stats.crossing_reduction + stats.positioning + stats.routing );
+}
@@ -0,0 +1,107 @@
+#include "catch.hpp"
+
+#include <drag/layout.hpp>
+
+#include <cmath>
+
+using namespace drag;
+
+
+TEST_CASE("layers are as high as their highest node") {
+    graph g;
+    for (int i = 0; i < 6; ++i) {
+        g.add_node();
+    }
+    g.add_edge(0, 1).add_edge(1, 2).add_edge(2, 3).add_edge(0, 4).add_edge(4, 5);
+    g.set_node_size(1, 40, 100);
+    g.set_node_size(2, 80, 10);
+    g.set_node_size(5, 30, 60, node_shape::ellipse);
+
+    sugiyama_layout layout(g);
+    const auto& nodes = layout.vertices();
+
+    // the layers are {0}, {1, 4}, {2, 5} and {3}
+    REQUIRE( nodes[1].pos.y == nodes[4].pos.y );
+    REQUIRE( nodes[2].pos.y == nodes[5].pos.y );
+    REQUIRE( nodes[1].pos.y - nodes[0].pos.y == Approx(g.node_size + g.layer_dist + 50) );
+    REQUIRE( nodes[2].pos.y - nodes[1].pos.y == Approx(50 + g.layer_dist + 30) );
+    REQUIRE( nodes[3].pos.y - nodes[2].pos.y == Approx(30 + g.layer_dist + g.node_size) );
+    REQUIRE( layout.height() == Approx(nodes[3].pos.y + g.node_size) );
+}
+
+TEST_CASE("layers of dummy vertices take no space") {
+    graph source;
+    source.add_node();
+    source.add_node();
+    source.add_edge(0, 1);
+
+    // the edge spans 3 layers, the 2 in the middle contain only dummy vertices
+    detail::subgraph g(source);
+    detail::hierarchy h(g);
+    h.ranking[0] = 0;
+    h.ranking[1] = 3;
+    h.layers = { { 0 }, {}, {}, { 1 } };
+    h.pos.resize(g);
+    detail::add_dummy_nodes(h);
+
+    attributes attr;
+    std::vector<node> nodes(g.size());
+    detail::vertex_map<detail::bounding_box> boxes(g, { { 0, 0 }, { 0, 0 } });
+    for (vertex_t u : { 0, 1 }) {
+        boxes[u] = { { 2*attr.node_size, 2*attr.node_size }, { attr.node_size, attr.node_size } };
+    }
+
+    detail::fast_and_simple_positioning positioning(attr, nodes, boxes, source);
+    auto dim = positioning.run(h, { 0, 0 });
+
+    REQUIRE( nodes[h.layers[1][0]].pos.y - nodes[0].pos.y == Approx(attr.node_size + attr.layer_dist) );
+    REQUIRE( nodes[h.layers[2][0]].pos.y - nodes[h.layers[1][0]].pos.y == Approx(attr.layer_dist) );
+    REQUIRE( nodes[1].pos.y - nodes[0].pos.y == Approx(2*attr.node_size + 3*attr.layer_dist) );
+    REQUIRE( dim.y == Approx(4*attr.node_size + 3*attr.layer_dist) );
+}
+
+TEST_CASE("debugging a layout") {
+    graph g;
+    for (int i = 0; i < 7; ++i) {
+        g.add_node();
+    }
+    g.add_edge(0, 1).add_edge(0, 2).add_edge(1, 3).add_edge(2, 3).add_edge(0, 3).add_edge(4, 5).add_edge(5, 6);
+
+    sugiyama_layout plain(g);
+    REQUIRE( plain.debug() == nullptr );
+
+    // the default switches change nothing
+    sugiyama_layout same(g, layout_debug{});
+    for (auto u : g.vertices()) {
+        REQUIRE( same.vertices()[u].pos == plain.vertices()[u].pos );
+    }
+
+    layout_debug debug;
+    debug.simplex_labels = true;
+    debug.crossing_reduction = false;
+    debug.alignment = 0;
+    sugiyama_layout layout(g, debug);
+
+    // labels of the vertices of both components
+    const auto& labels = layout.debug()->labels;
+    REQUIRE( labels.size() == g.size() );
+    REQUIRE( labels.at(4).rfind("4(", 0) == 0 );
+    REQUIRE( layout.statistics().crossing_passes == 0 );
+    for (auto u : g.vertices()) {
+        REQUIRE( layout.vertices()[u].pos.y == plain.vertices()[u].pos.y );
+    }
+
+    // a single alignment places the vertices differently than the median of all four
+    auto differs = [&] (const sugiyama_layout& other) {
+        for (auto u : g.vertices()) {
+            if (layout.vertices()[u].pos.x != other.vertices()[u].pos.x) {
+                return true;
+            }
+        }
+        return false;
+    };
+    debug.alignment = -1;
+    REQUIRE( differs(sugiyama_layout(g, debug)) );
+    debug.alignment = 1;
+    REQUIRE( differs(sugiyama_layout(g, debug)) );
+}
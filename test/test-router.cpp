@@ -0,0 +1,289 @@
+#include "catch.hpp"
+
+#include <drag/drag.hpp>
+#include <drag/detail/gen.hpp>
+
+#include <cmath>
+
+using namespace drag;
+
+
+static float segment_point_dist(vec2 from, vec2 to, vec2 p) {
+    auto d = to - from;
+    float len = dot(d, d);
+    float t = len == 0 ? 0 : std::max(0.0f, std::min(1.0f, dot(p - from, d) / len));
+    return distance(from + t*d, p);
+}
+
+static void check_paths(const graph& g, const sugiyama_layout& layout) {
+    const auto& nodes = layout.vertices();
+    float eps = 0.01;
+
+    for (const auto& p : layout.edges()) {
+        REQUIRE( p.points.size() >= 2 );
+
+        // the paths start and end on the borders of the nodes
+        REQUIRE( std::abs(distance(p.points.front(), nodes[p.from].pos) - nodes[p.from].size) < eps );
+        REQUIRE( std::abs(distance(p.points.back(), nodes[p.to].pos) - nodes[p.to].size) < eps );
+
+        // and don't go through any other node
+        for (size_t i = 1; i < p.points.size(); ++i) {
+            for (const auto& n : nodes) {
+                if (n.u == p.from || n.u == p.to)
+                    continue;
+                REQUIRE( segment_point_dist(p.points[i - 1], p.points[i], n.pos) > n.size );
+            }
+        }
+    }
+
+    int edge_count = 0;
+    for (auto u : g.vertices()) {
+        edge_count += g.out_neighbours(u).size();
+    }
+    REQUIRE( layout.edges().size() == edge_count );
+}
+
+TEST_CASE("routed edges avoid nodes") {
+    dag_generator gen(17);
+
+    for (int i = 0; i < 20; ++i) {
+        graph g = gen.generate_from_edges(10 + i, 15 + 2*i);
+        sugiyama_layout layout(g);
+        check_paths(g, layout);
+    }
+}
+
+TEST_CASE("routing is deterministic") {
+    dag_generator gen(23);
+    graph g = gen.generate_from_edges(30, 50);
+
+    sugiyama_layout first(g);
+    sugiyama_layout second(g);
+
+    REQUIRE( first.edges().size() == second.edges().size() );
+    for (size_t i = 0; i < first.edges().size(); ++i) {
+        REQUIRE( first.edges()[i].points == second.edges()[i].points );
+    }
+}
+
+TEST_CASE("orthogonal routing uses only horizontal and vertical segments") {
+    dag_generator gen(31);
+
+    for (int i = 0; i < 20; ++i) {
+        graph g = gen.generate_from_edges(10 + i, 15 + 2*i);
+        auto a = g.add_node();
+        auto b = g.add_node();
+        auto c = g.add_node();
+        g.add_edge(a, b);
+        g.add_edge(b, c);
+        g.add_edge(c, a);
+        g.add_edge(c, 0);
+        g.add_edge(0, 0);
+        g.routing = edge_routing::orthogonal;
+
+        sugiyama_layout layout(g);
+        check_paths(g, layout);
+
+        for (const auto& p : layout.edges()) {
+            for (size_t j = 1; j < p.points.size(); ++j) {
+                REQUIRE( (p.points[j - 1].x == p.points[j].x || p.points[j - 1].y == p.points[j].y) );
+            }
+        }
+    }
+}
+
+TEST_CASE("spline routing produces curves avoiding nodes") {
+    dag_generator gen(17);
+
+    for (int i = 0; i < 20; ++i) {
+        graph g = gen.generate_from_edges(10 + i, 15 + 2*i);
+        g.add_edge(0, 0);
+        sugiyama_layout lines(g);
+
+        g.routing = edge_routing::spline;
+        sugiyama_layout curves(g);
+        const auto& nodes = curves.vertices();
+
+        REQUIRE( curves.edges().size() == lines.edges().size() );
+        for (size_t j = 0; j < curves.edges().size(); ++j) {
+            const auto& c = curves.edges()[j];
+            const auto& l = lines.edges()[j];
+            REQUIRE( c.points.front() == l.points.front() );
+            REQUIRE( c.points.back() == l.points.back() );
+            if (!c.curved) {
+                REQUIRE( c.points == l.points );
+                continue;
+            }
+            REQUIRE( c.points.size() % 3 == 1 );
+            if (c.from == c.to)
+                continue;
+
+            for (size_t k = 0; k + 3 < c.points.size(); k += 3) {
+                detail::bezier b = { c.points[k], c.points[k + 1], c.points[k + 2], c.points[k + 3] };
+                for (int s = 0; s <= 100; ++s) {
+                    auto p = detail::bezier_point(b, s/100.0f);
+                    for (const auto& n : nodes) {
+                        if (n.u != c.from && n.u != c.to) {
+                            REQUIRE( distance(p, n.pos) > n.size - 0.5f );
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("concentrated edges are split again by the routers") {
+    dag_generator gen(41);
+
+    for (auto routing : { edge_routing::polyline, edge_routing::orthogonal, edge_routing::spline }) {
+        for (int i = 0; i < 10; ++i) {
+            graph g = gen.generate_from_edges(15 + i, 30 + 3*i);
+            g.routing = routing;
+            g.concentrate = true;
+            sugiyama_layout layout(g);
+
+            // each edge gets its own path
+            std::vector<std::pair<vertex_t, vertex_t>> expected, actual;
+            for (auto u : g.vertices()) {
+                for (auto v : g.out_neighbours(u)) {
+                    expected.emplace_back(u, v);
+                }
+            }
+            for (const auto& p : layout.edges()) {
+                actual.emplace_back(p.from, p.to);
+                REQUIRE( p.points.front() != p.points.back() );
+            }
+            std::sort(expected.begin(), expected.end());
+            std::sort(actual.begin(), actual.end());
+            REQUIRE( actual == expected );
+        }
+    }
+}
+
+// is the point <p> on the border of the node <n>?
+static bool on_border(const node& n, vec2 p) {
+    vec2 d = p - n.pos;
+    if (n.shape == node_shape::rectangle) {
+        return std::abs(std::max(std::abs(d.x)/n.half_size.x, std::abs(d.y)/n.half_size.y) - 1) < 0.01f;
+    }
+    float x = d.x/n.half_size.x;
+    float y = d.y/n.half_size.y;
+    return std::abs(x*x + y*y - 1) < 0.01f;
+}
+
+TEST_CASE("nodes of different sizes and shapes") {
+    dag_generator gen(53);
+
+    for (auto routing : { edge_routing::polyline, edge_routing::orthogonal, edge_routing::spline }) {
+        for (int i = 0; i < 10; ++i) {
+            graph g = gen.generate_from_edges(10 + i, 15 + 2*i);
+            g.add_edge(1, 1);
+            g.routing = routing;
+            for (auto u : g.vertices()) {
+                if (u % 3 != 0) {
+                    g.set_node_size(u, 20 + 17*(u % 7), 20 + 5*(u % 4), u % 3 == 1 ? node_shape::rectangle : node_shape::ellipse);
+                }
+            }
+            sugiyama_layout layout(g);
+            const auto& nodes = layout.vertices();
+
+            for (auto u : g.vertices()) {
+                REQUIRE( 2*nodes[u].half_size == g.node_dimensions(u) );
+                REQUIRE( nodes[u].shape == g.shape(u) );
+            }
+
+            // the nodes don't overlap and keep their distance
+            for (const auto& a : nodes) {
+                for (const auto& b : nodes) {
+                    if (a.u == b.u)
+                        continue;
+                    if (a.pos.y == b.pos.y) {
+                        REQUIRE( std::abs(a.pos.x - b.pos.x) >= a.half_size.x + b.half_size.x + g.node_dist - 0.01f );
+                    } else {
+                        REQUIRE( std::abs(a.pos.y - b.pos.y) >= a.half_size.y + b.half_size.y + g.layer_dist - 0.01f );
+                    }
+                }
+            }
+
+            // the edges start and end on the borders and don't go through other nodes
+            for (const auto& p : layout.edges()) {
+                REQUIRE( on_border(nodes[p.from], p.points.front()) );
+                REQUIRE( on_border(nodes[p.to], p.points.back()) );
+                if (p.curved)
+                    continue;
+
+                for (size_t j = 1; j < p.points.size(); ++j) {
+                    for (int s = 0; s <= 20; ++s) {
+                        auto q = p.points[j - 1] + (s/20.0f)*(p.points[j] - p.points[j - 1]);
+                        for (auto n : nodes) {
+                            n.half_size -= 0.5f;
+                            if (n.u != p.from && n.u != p.to) {
+                                REQUIRE( !detail::contains(n, q) );
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+static float line_point_dist(vec2 from, vec2 to, vec2 p) {
+    auto d = to - from;
+    return distance(from + (dot(p - from, d) / dot(d, d))*d, p);
+}
+
+// the search used before the closed form: the shift is raised in steps of 5 until the line clears the point
+static float stepped_clearing_shift(vec2 p, float dir_y, float start, vec2 other, vec2 c, float r, float max_shift) {
+    float s = start;
+    while (s <= max_shift && line_point_dist(p + vec2{ 0, dir_y*s }, other, c) <= r) {
+        s += 5;
+    }
+    return std::min(s, max_shift);
+}
+
+TEST_CASE("closed form shifts match the stepped search") {
+    dag_generator gen(61);
+    std::vector<graph> graphs = {
+        graph_builder().add_edge(0, 1).add_edge(0, 2).add_edge(0, 3).add_edge(1, 4).add_edge(3, 4).add_edge(0, 4).build(),
+        graph_builder().add_edge(0, 3).add_edge(1, 3).add_edge(2, 3).add_edge(0, 4).add_edge(2, 5).add_edge(4, 5).build(),
+    };
+    for (int i = 0; i < 10; ++i) {
+        graphs.push_back(gen.generate_from_edges(10 + 2*i, 20 + 4*i));
+    }
+
+    int compared = 0;
+    for (const auto& g : graphs) {
+        sugiyama_layout layout(g);
+        const auto& nodes = layout.vertices();
+
+        // the end of every edge shifted to clear every node between its ends, in both directions
+        for (const auto& p : layout.edges()) {
+            const auto& from = nodes[p.from];
+            const auto& to = nodes[p.to];
+            for (const auto& n : nodes) {
+                bool between = (n.pos.x - from.pos.x) * (n.pos.x - to.pos.x) < 0;
+                if (n.u == p.from || n.u == p.to || !between || from.pos.y == to.pos.y)
+                    continue;
+
+                for (float dir_y : { 1.0f, -1.0f }) {
+                    float r = n.size + 5;
+                    float stepped = stepped_clearing_shift(from.pos, dir_y, 0, to.pos, n.pos, r, from.size);
+                    float exact = detail::min_clearing_shift(from.pos, dir_y, 0, to.pos, n.pos, r, from.size);
+
+                    // the closed form finds the smallest shift, the steps overshoot it by less than a step
+                    REQUIRE( exact <= stepped + 0.001f );
+                    if (stepped < from.size) {
+                        REQUIRE( exact > stepped - 5 );
+                    }
+                    if (exact < from.size) {
+                        REQUIRE( line_point_dist(from.pos + vec2{ 0, dir_y*exact }, to.pos, n.pos) >= r - 0.01f );
+                    }
+                    ++compared;
+                }
+            }
+        }
+    }
+    REQUIRE( compared > 100 );
+}
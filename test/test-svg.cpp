@@ -0,0 +1,163 @@
+#include "catch.hpp"
+
+#include <drag/drawing/draw.hpp>
+#include <drag/detail/gen.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace drag;
+
+
+// the document of the layout built in memory by svg_image and saved into a file
+static std::string saved_image(const sugiyama_layout& layout, const drawing_options& opts) {
+    const char* filename = "test-image.svg";
+    draw_svg_image(layout, opts).save(filename);
+
+    std::ifstream in(filename, std::ios::binary);
+    std::stringstream data;
+    data << in.rdbuf();
+    in.close();
+    std::remove(filename);
+    return data.str();
+}
+
+// the document of the layout streamed by svg_writer, and the sizes of the chunks passed to the sink
+static std::string streamed_image(const sugiyama_layout& layout, const drawing_options& opts, std::vector<size_t>& chunks) {
+    std::string data;
+    svg_writer out([&] (const char* text, size_t size) {
+        data.append(text, size);
+        chunks.push_back(size);
+    });
+    draw_svg_image(out, layout, opts);
+    return data;
+}
+
+TEST_CASE("streamed svg is the same as the image in memory") {
+    graph g = graph_builder()
+                .add_edge(0, 1).add_edge(1, 0)
+                .add_edge(0, 2).add_edge(2, 3).add_edge(0, 3)
+                .add_edge(3, 3)
+                .build();
+    g.set_node_size(2, 60, 20, node_shape::rectangle);
+    g.set_node_size(3, 40, 20, node_shape::ellipse);
+    g.routing = edge_routing::spline;
+    sugiyama_layout layout(g);
+
+    drawing_options opts;
+    opts.labels[1] = "one";
+    opts.colors[2] = "red";
+    opts.edge_colors[{ 0, 2 }] = "blue";
+
+    auto curved = [] (path_ref p) { return p.curved; };
+    auto bidirectional = [] (path_ref p) { return p.bidirectional; };
+    REQUIRE( std::any_of(layout.edges().begin(), layout.edges().end(), curved) );
+    REQUIRE( std::any_of(layout.edges().begin(), layout.edges().end(), bidirectional) );
+
+    std::vector<size_t> chunks;
+    std::string streamed = streamed_image(layout, opts, chunks);
+    REQUIRE( streamed == saved_image(layout, opts) );
+    REQUIRE( streamed.find("<path ") != std::string::npos );
+    REQUIRE( streamed.find("<rect ") != std::string::npos );
+    REQUIRE( streamed.find("<ellipse ") != std::string::npos );
+    REQUIRE( chunks.size() == 1 );
+}
+
+TEST_CASE("svg larger than the buffer") {
+    dag_generator gen(71);
+    graph g = gen.generate_from_edges(400, 800);
+    g.add_edge(0, 1);
+    g.add_edge(1, 0);
+    sugiyama_layout layout(g);
+
+    std::vector<size_t> chunks;
+    std::string streamed = streamed_image(layout, {}, chunks);
+    REQUIRE( streamed.size() > (1 << 16) );
+    REQUIRE( streamed == saved_image(layout, {}) );
+
+    // the buffer was flushed several times and never passed more than its size at once
+    REQUIRE( chunks.size() > 1 );
+    for (auto size : chunks) {
+        REQUIRE( size <= (1 << 16) );
+    }
+
+    // a text longer than the buffer is passed to the sink directly, after the buffered data
+    std::string data;
+    chunks.clear();
+    {
+        svg_writer out([&] (const char* text, size_t size) {
+            data.append(text, size);
+            chunks.push_back(size);
+        });
+        out.write("<g>");
+        out.write(std::string(100000, 'x'));
+        out.write("</g>");
+    }
+    REQUIRE( data == "<g>" + std::string(100000, 'x') + "</g>" );
+    REQUIRE( chunks == std::vector<size_t>{ 3, 100000, 4 } );
+}
+
+TEST_CASE("svg sink errors reach the caller") {
+    int calls = 0;
+    auto failing = [&] (const char*, size_t) {
+        ++calls;
+        throw std::runtime_error("sink failed");
+    };
+
+    // the writer is destroyed while the error propagates and does not call the sink again
+    bool caught = false;
+    try {
+        svg_writer out(failing);
+        out.begin({ 100, 100 }, 10);
+        out.end();
+    } catch (const std::runtime_error&) {
+        caught = true;
+    }
+    REQUIRE( caught );
+    REQUIRE( calls == 1 );
+
+    // the destructor swallows the error of the final flush
+    calls = 0;
+    {
+        svg_writer out(failing);
+        out.write("<g>");
+    }
+    REQUIRE( calls == 1 );
+
+    // an explicit flush reports it, and leaves nothing for the destructor
+    calls = 0;
+    {
+        svg_writer out(failing);
+        out.write("<g>");
+        REQUIRE_THROWS_AS( out.flush(), std::runtime_error );
+    }
+    REQUIRE( calls == 1 );
+}
+
+#ifdef __linux__
+TEST_CASE("svg file errors reach the caller") {
+    // the data fits into the buffers of svg_writer and stdio and fails only when flushed by end
+    {
+        svg_writer out(std::string("/dev/full"));
+        out.begin({ 100, 100 }, 10);
+        REQUIRE_THROWS_AS( out.end(), std::runtime_error );
+    }
+
+    std::FILE* file = std::fopen("/dev/full", "wb");
+    REQUIRE( file );
+    {
+        svg_writer out(file);
+        out.write("<g>");
+        REQUIRE_THROWS_AS( out.flush(), std::runtime_error );
+
+        // a text longer than the buffer goes directly to the file and fails right away
+        REQUIRE_THROWS_AS( out.write(std::string(100000, 'x')), std::runtime_error );
+    }
+    std::fclose(file);
+}
+#endif